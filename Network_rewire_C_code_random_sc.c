@@ -45,546 +45,495 @@ Rewire steps.
 #include <math.h>
 #include <time.h>
 #include <malloc.h>
+#include <stdint.h>
+
+#include "rewire_engine.h" // matching engine; build with: gcc Network_rewire_C_code_random_sc.c rewire_engine.c network_metrics.c histogram_file.c -lm
+#include "network_metrics.h"
+#include "histogram_file.h"
 
 /* STRUCTURE DECLARATIONS----------------------------------------------------- */  
-  struct stub_node {
-      int farm_id;   
-      int batch_type;
-      struct stub_node *next_node;
-   };   
+  /* Outputs handed to the engine callbacks*/
+  struct driver_output {
+      FILE *Rewired; // NULL unless write_rewired == 1
+      struct network_graph *Graph; // edges of the current iteration, NULL unless network_metrics == 1
+      struct temporal_reach *Reach; // movements of the iterations solved together, NULL unless temporal_reach == 1
+      int reach_slot; // slot of Reach the current iteration goes to
+      FILE *Unmatched; // NULL unless write_unmatched == 1
+   };
+
+  /* Progress lines of Loop A, at most one per interval seconds*/
+  struct progress_report {
+      int verbosity;
+      double interval;
+      time_t start, last;
+      long int total; // iterations
+   };
+
+  /* Temporal reachability of each farm over the iterations*/
+  struct reach_summary {
+      int32_t *observed; // farms reachable in the observed network
+      double *sum, *sum_sq;
+      int32_t *min, *max;
+      int32_t largest; // largest reachability in any network
+   };
+
 /* ########################################################################## */
 /* FUNCTION DEFINITIONS */
   
-void read_farm_data(); 
-void read_movement_data() ;
-void fill_prob_array(); 
-void add_node_to_day();
-void visualize_list();
-void count_batch_by_distance() ;
-void distance_interval_data();
-
-int write_freq_dis();
-int comp_day();
-int comp_random();
-double calc_dis() ;
-
-unsigned int rand_interval();
-
-int write_rewired_data();
-int remove_node_from_day();
-int write_freq_data();
+int write_freq_dis(char FreqDisFile[], int32_t *dis_array, long int num_rows, int num_simu);
+int write_freq_data(char DCAfreqDataFile[], int32_t *FreqTestArea, int num_simu, int dca_combination);
+int write_hist(char HistFile[], char scenario[], char quantity[], int batch_type, unsigned int seed, int32_t *table, long int num_bins, int num_simu, int layout);
+void store_rewired_move(const struct rewire_match *match, void *user);
+void write_network_metrics(FILE *Metrics, FILE *DegreeDis, long int count_iter, const struct network_metrics *metrics);
+void count_reach_sizes(const int32_t *reach_size, long int num_farms, int num_slots, long int first_column, int32_t *FreqReach, int num_simu, struct reach_summary *summary);
+int write_reach_farm(char ReachFarmFile[], const struct farm_table *FarmData, const struct reach_summary *summary, int num_simu);
+void write_unmatched_stub(long int count_iter, int day, int farm_id, int batch_type, void *user);
+void report_progress(struct progress_report *report, long int count_iter, const struct rewire_iteration_stats *stats);
 
 
    
 /* ########################################################################## */
 /* MAIN PROGRAM */
 int main(void){
-       srand((unsigned)time(NULL));
+       unsigned int seed = (unsigned)time(NULL); // recorded in the histogram files
+       srand(seed);
 /* 1. SPECIFY VARIABLES AND THE DATA STORAGE FOR THE OUTCOME------------------------*/
     
     /* 1. USER DEFINED VARIABLES ------------------------------------------------ */
       char FarmDataFile[] = "/C_run/Data/farm_short_discat.csv";// Read in farm information
       long int num_farms = 10233; 
-      long int num_farm_var = 5;
       
       char MoveDataFile[] = "/C_run/Data/final_movement_data_2010_analysis_v6_1.csv"; // Read in batch information
       long int num_moves = 23443; 
+      int stream_moves = 0; // 0: load all movements in memory. 1: read MoveDataFile day by day every iteration (file must be sorted by day, num_moves is then ignored), with their predictions from PredictionFile
       
       char DistanceIntervalFile[] = "/C_run/Data/DistanceIntervalFile.csv"; // Read in predicted distance information
       long int num_covs = 23443; // set the number of rows
-      int num_covs_var = 1000; // set the number of columns
       int num_simu = 1000;
+      char PredictionFile[] = "/C_run/Data/PredictionFile.bin"; // stream_moves only, instead of DistanceIntervalFile: its predictions in the line order of MoveDataFile, made by tools/make_stream_predictions.c
       
-      int distant_cat, distance_cat_this_move;
-      
-      long int num_move_vars = 6;
-      long int num_rewired_move_vars = 9; 
+      int road_distances = 0; // 1: take the distance of the farm pairs in RoadDistanceFile from it, straight line distance for the others
+      char RoadDistanceFile[] = "/C_run/Data/RoadDistanceFile.bin"; // made by tools/make_road_distances.c from a CSV of source farm, destination farm, km
       
       /*Set the output files*/
       char RewiredDataFile[] = "/C_run/out/RewiredDataFile_baseline_v1.csv";
+      int write_rewired = 0; // 1: append each matched movement to RewiredDataFile as soon as it is made
+      char UnmatchedStubFile[] = "/C_run/out/UnmatchedStubFile_baseline_v1.csv"; // per stub left without a partner: iteration, day, farm, batch type
+      int write_unmatched = 0; // 1: write the stubs left unmatched at the end of each day to UnmatchedStubFile
       char FreqDisFile[] = "/C_run/out/FreqDisFile_baseline_v1_all.csv";
       char FreqDisFile_calf[] = "/C_run/out/FreqDisFile_baseline_v1_calf.csv";
       char FreqDisFile_heifer[] = "/C_run/out/FreqDisFile_baseline_v1_heifer.csv";
       char FreqDisFile_adult[] = "/C_run/out/FreqDisFile_baseline_v1_adult.csv";
       char DCAfreqDataFile[] = "/C_run/out/DCAfreqDataFile_baseline_v1.csv";
+      /* Histogram output*/
+      char scenario[] = "baseline_v1"; // recorded in the histogram files
+      int hist_format = 0; // 0: CSV files above. 1: compressed binary files below (tools/hist_to_csv.c gives back the CSV, tools/hist_slice.c cuts iterations and bins out). 2: both
+      char FreqDisHist[] = "/C_run/out/FreqDisFile_baseline_v1_all.rwh";
+      char FreqDisHist_calf[] = "/C_run/out/FreqDisFile_baseline_v1_calf.rwh";
+      char FreqDisHist_heifer[] = "/C_run/out/FreqDisFile_baseline_v1_heifer.rwh";
+      char FreqDisHist_adult[] = "/C_run/out/FreqDisFile_baseline_v1_adult.rwh";
+      char DCAfreqDataHist[] = "/C_run/out/DCAfreqDataFile_baseline_v1.rwh";
+      char FreqReachHist[] = "/C_run/out/FreqReachFile_baseline_v1.rwh";
+      
+      /* Network metrics of each rewired network, computed in memory after Loop B*/
+      int network_metrics = 0; // 1: compute the metrics of every iteration's matched movements
+      int reach_steps = 2; // farms reachable within this number of movements
+      char NetworkMetricsFile[] = "/C_run/out/NetworkMetricsFile_baseline_v1.csv"; // per iteration: iteration, batches, links, active farms, max out/in degree, mean degree, out strength by DCA 0-5, in strength by DCA 0-5, largest SCC, largest WCC, mean and max reach
+      char DegreeDisFile[] = "/C_run/out/DegreeDisFile_baseline_v1.csv"; // per iteration and degree: iteration, degree, farms with that out degree, farms with that in degree
       
-      int src_testarea, des_testarea,test_area_comb;// src_testarea, des_testarea specify the DCA status for source and destination farm respectively.
-      // 0 is MCA(Area4), 1 is STA(Area3), 2 is STB(Area2), 3 is STD(Area1b), and 4 is STT(Area1a). test_area_comb defines the unique 26 combinations of src and des DCA status
+      /* Temporal reachability: farms reachable from each farm through movements on increasing days*/
+      int temporal_reach = 0; // 1: compute the reachability of every farm in the observed and every rewired network
+      int reach_batch = 8; // number of iterations whose reachability is computed together
+      char FreqReachFile[] = "/C_run/out/FreqReachFile_baseline_v1.csv"; // like FreqDisFile: row r counts the farms that reach r other farms, column 0 observed, then one column per iteration
+      char ReachFarmFile[] = "/C_run/out/ReachFarmFile_baseline_v1.csv"; // per farm: farm id, observed, mean, sd, min and max over the iterations
+      
+      /* Console output*/
+      int verbosity = 1; // 0: errors only, on stderr. 1: setup and a progress line with ETA every progress_interval seconds. 2: also each preparation step and every iteration
+      double progress_interval = 10; // seconds
       
       long int i = 0;
-      long int j = 0;
-      long int h = 0;
-      long int batch = 0 ; //counter for each batch in movement data
       long int count_iter = 0; // counter for iterations
-      double src_x, src_y, des_x, des_y ;
+      int hist_failed = 0; // number of .rwh files that could not be written
       int max_dis = 0; // initialise the maximum distance, which will be overwritten soon by calculating the real data
-      int dca_combination = 26; //25 combinations 5*5 and column[25] for batch that includes at least one unknown testarea
+      long int num_rows; // rows of the distance arrays, 0 to max_dis km
+      
+      struct rewire_config config;
+      rewire_default_config(&config);
+      config.num_simu = num_simu;
+      config.error_range_day_movement = 7 ;//Erro Range of days that will be allowed for inward stubs.
+      config.symmetric_window = 0 ; // 1: inward stubs may also come from the error_range_day_movement days after the movement (+/- window)
+      config.prune_buckets = 1 ; // 1: skip buckets whose bounding box shows they can not beat the best inward stub found so far
       
-      int src_farm_id, des_farm_id,dis_src_des ;
-      int num_days = 365 ;
-      int current_day ;
-      int error_range_day_movement = 7 ;//Erro Range of days that will be allowed for inward stubs.
-      int search_day;
+      /* Stratification of candidate inward stubs (batch type is always matched)*/
+      config.strat_island = 0; // 1: inward stub must come from a farm on the same island as the destination
+      config.strat_dca = 0; // 1: only source/destination DCA combinations allowed in AllowedDCAFile are matched
+      char AllowedDCAFile[] = "/C_run/Data/AllowedDCAFile.csv"; // 6x6 matrix of 0/1, rows source DCA 0-4 and unknown, columns destination DCA
+      
+      /* Matching engine*/
+      config.match_engine = 0; // 0: greedy, each outward stub takes its best inward stub in random order. 1: min-cost assignment of each (batch type, stratum) block of the days whose windows overlap, kept one day at a time
+      config.assign_candidates = 128; // engine 1: number of cheapest inward stubs kept per destination before solving (0 keeps all). Fewer make a block cheaper to scan, but it is solved again with more when they leave a stub unmatched
+      config.assign_unmatched_cost = 0; // engine 1: km an outward stub left unmatched counts as. 0: every stub that can be matched is. With the window before the movement only, stubs of other days are used only when some are left unmatched, so a finite cost (e.g. max_dis) lets the window trade a few unmatched stubs for a lower total
+      int compare_greedy = 0; // engine 1: also run the greedy engine on every iteration, with the same random numbers (srand(seed + iteration) before each run) and predictions
+      char AssignCostFile[] = "/C_run/out/AssignCostFile_baseline_v1.csv"; // engine 1 or compare_greedy only. Per iteration: iteration, engine, matched, total |selected_dis - distance|, then matched and total of the greedy engine (-1,-1 with engine 1 unless compare_greedy)
      
       
 /*2. READ DATA AND PREPARE THE OUTCOME STORAGE-------------------------------------------------*/   
 /* PREPARATION OF DATA AND OUTPUT FILE.
-2.1 PREPARE THE FRAME OF PAIR-WISE DISTANCE MATRIX FOR ALL FARMS.
-2.2 READ FARM DATA.
-2.3 READ MOVEMENT DATA.
-2.4 FILL IN DISTANCE MATRIX.
-2.5 CREATE ARRAY OF DISTANCE THAT STORES DISTANCE FREQUENCY AND FILL BY 0.
-    2.5.1 CREATE DATAFRAME FOR FREQUENCY BETWEEN EACH DISEASE CONTROL AREA
+2.1 READ FARM DATA AND CREATE THE ENGINE.
+2.2 READ MOVEMENT DATA.
+2.3 FILL IN DISTANCE MATRIX (OPTIONALLY WITH ROAD DISTANCES).
+2.4 CREATE ARRAY OF DISTANCE THAT STORES DISTANCE FREQUENCY AND FILL BY 0.
+    2.4.1 CREATE DATAFRAME FOR FREQUENCY BETWEEN EACH DISEASE CONTROL AREA
+2.5 OPTIONAL: OPEN THE FILE THAT STORES GENERATED REWIRED MOVEMENT.
+    2.5.1 OPTIONAL: PREPARE THE GRAPH AND FILES OF THE NETWORK METRICS.
+    2.5.2 OPTIONAL: PREPARE THE TEMPORAL REACHABILITY.
 2.6 GENERATE THE DISTANCE FREQUENCY FOR THE OBSERVED DATA AND FILL THE FIRST COLUMN OF DISTANCE ARRAY.
-    2.6.1 FILL OUT THE FREQUENCY OF BETWEEN AND WITHIN DCA MOVEMENT.
-    2.6.2 CREATE AND READ IN THE PREDICTED DISTANCE FILES.
-2.7 OPTIONAL: VISUALISE THE INWARD STUBS THAT ARE AVAILABLE On A GIVEN DAY.
-2.8 OPTIONAL: CREATE DATAFRAME THAT STORES GENERATED REWIRED MOVEMENT. */
-
-
-/*2.1Distance matrix*/
-      int **dis_matrix = (int**)malloc(sizeof(int*)*num_farms);
-      for(i = 0; i < num_farms; i++)
-        {
-            /*Then, for each row, specifies the required memory size for column*/
-          dis_matrix[i] = (int*)malloc( sizeof(int) * num_farms);  
-        }
+2.7 CREATE AND READ IN THE PREDICTED DISTANCE FILES. */
 
+      if (config.strat_dca == 1)
+      {
+      rewire_read_allowed_dca(AllowedDCAFile, config.allowed_dca);
+      }
+
+/* 2.1  Read in Farm Data */
+      struct farm_table FarmData;
+      FarmData.num_farms = num_farms;
+      FarmData.x_coord = (double*)malloc(sizeof(double) * num_farms);
+      FarmData.y_coord = (double*)malloc(sizeof(double) * num_farms);
+      FarmData.farm_id = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+      FarmData.testarea = (uint8_t*)malloc(sizeof(uint8_t) * num_farms);
+      FarmData.island = (uint8_t*)malloc(sizeof(uint8_t) * num_farms);
+      rewire_read_farm_data(FarmDataFile, &FarmData, num_farms); 
+      struct rewire_engine *engine = rewire_create(&config, &FarmData);
       
-/* 2.2  Read in Farm Data */
-    /* First create array FarmData, which specifies the row memory size*/
-      double **FarmData = (double**)malloc( sizeof(double *) * num_farms);
-      for(i = 0; i < num_farms; i++)
-        {
-            /*Then, for each row, specifies the required memory size for column*/
-          FarmData[i] = (double*)malloc( sizeof(double) * num_farm_var);  
-        }
-      read_farm_data(FarmDataFile, FarmData, num_farms); 
-      
-/*2.3 Read movement data*/
-          double **MoveData = (double**)malloc( sizeof(double *) * num_moves);
-          for(i = 0; i < num_moves; i++)
-                {
-                MoveData[i] = (double*)malloc( sizeof(double) * num_move_vars);  
-                }
-                read_movement_data(MoveDataFile, MoveData, num_moves); 
+/*2.2 Read movement data*/
+          struct move_table MoveData = {0};
+          FILE *MoveFile = NULL;
+          if (stream_moves == 1)
+          {
+          MoveFile = fopen(MoveDataFile, "r");
+          rewire_set_move_file(engine, MoveFile);
+          }
+          else
+          {
+          MoveData.num_moves = num_moves;
+          MoveData.src_farm = (int32_t*)malloc(sizeof(int32_t) * num_moves);
+          MoveData.des_farm = (int32_t*)malloc(sizeof(int32_t) * num_moves);
+          MoveData.move_id = (int32_t*)malloc(sizeof(int32_t) * num_moves);
+          MoveData.day = (uint16_t*)malloc(sizeof(uint16_t) * num_moves);
+          MoveData.batch_type = (uint8_t*)malloc(sizeof(uint8_t) * num_moves);
+                rewire_read_movement_data(MoveDataFile, &MoveData, num_moves); 
+          rewire_set_moves(engine, &MoveData);
+          }
  
- /*2.4 FILL OUT THE DISTANCE MATRIX*/
- /* Note: The calculating speed can be improved because it's calculating the pair-wise distance twice*/
-     for (i =0 ; i < num_farms; i++)
+ /*2.3 FILL OUT THE DISTANCE MATRIX*/
+     if (road_distances == 1)
      {
-         src_x = FarmData[i][1];
-         src_y = FarmData[i][2];
-         
-         for (j = 0; j < num_farms; j++)
+         long int num_road = rewire_load_road_distances(engine, RoadDistanceFile);
+         if (num_road < 0)
          {
-             des_x = FarmData[j][1] ;
-             des_y = FarmData[j][2] ;
-             dis_matrix[i][j] = calc_dis(src_x, src_y, des_x, des_y) ;
-             if (dis_matrix[i][j] > max_dis)
-             {
-             max_dis = dis_matrix[i][j];
-             }
+         fprintf(stderr, "Can not use %s, straight line distances only\n", RoadDistanceFile);
          }
+         else if (verbosity >= 1)
+         {
+         printf("%ld road distances read\n", num_road);
+         }
+     }
+     max_dis = rewire_build_distances(engine);
+     if (road_distances == 1 && verbosity >= 1)
+     {
+     printf("Road distances are up to %d km shorter than the straight line\n", rewire_road_slack(engine));
+     }
+     if (verbosity >= 1)
+     {
+     printf("Maximum distance %d km\n", max_dis) ; // max_dis is maximum possible distance between two farms in NZ
      }
-     printf("%d\n", max_dis) ; // max_dis is maximum possible distance between two farms in NZ
-    // system("pause") ;
     
-/*2.5 COUNT OUT THE DISTANCE AND SAVE THE COUNT IN DISTANCE ARRAY*/
-      /*Distance array for all movements*/
-                int **dis_array = (int**)malloc(sizeof(int*)*max_dis) ; //prepare the memory for the length of distance for all movements
-                /*Distance array for calf*/
-                int **dis_array_calf = (int**)malloc(sizeof(int*)*max_dis) ; //prepare the memory for the length of distance for calf movements
-                /*Distance array for heifer*/
-                int **dis_array_heifer = (int**)malloc(sizeof(int*)*max_dis) ; //prepare the memory for the length of distance for heifer movements
-                /*Distance array for adult*/
-                int **dis_array_adult = (int**)malloc(sizeof(int*)*max_dis) ; //prepare the memory for the length of distance for adult movements
-                
-                for (i =0; i < max_dis; i++) 
-                {
-                dis_array[i] = (int*)malloc(sizeof(int)*(num_simu+1)) ; 
-                dis_array_calf[i] = (int*)malloc(sizeof(int)*(num_simu+1)) ;
-                dis_array_heifer[i] = (int*)malloc(sizeof(int)*(num_simu+1)) ;
-                dis_array_adult[i] = (int*)malloc(sizeof(int)*(num_simu+1)) ;
-                 }
-                 /*Fill distance array with 0*/
-                 for (i = 0 ; i < max_dis; i++)
-                 {
-                 for (j=0; j < num_simu+1 ; j++)
-                  {
-                  dis_array[i][j] = 0 ;
-                  dis_array_calf[i][j] = 0 ;
-                  dis_array_heifer[i][j] = 0 ;
-                  dis_array_adult[i][j] = 0 ;
-                  }
-                  } 
-      
+/*2.4 COUNT OUT THE DISTANCE AND SAVE THE COUNT IN DISTANCE ARRAY*/
+      /* One row per km from 0 to max_dis, num_simu+1 columns, in one zeroed block each*/
+      num_rows = rewire_hist_rows(engine);
+      struct rewire_histograms hist;
+      hist.dis_all = (int32_t*)calloc(num_rows * (num_simu+1), sizeof(int32_t)) ; // all movements
+      hist.dis_calf = (int32_t*)calloc(num_rows * (num_simu+1), sizeof(int32_t)) ; // calf movements
+      hist.dis_heifer = (int32_t*)calloc(num_rows * (num_simu+1), sizeof(int32_t)) ; // heifer movements
+      hist.dis_adult = (int32_t*)calloc(num_rows * (num_simu+1), sizeof(int32_t)) ; // adult movements
                
-/*2.5.1 CREATE DATAFRAME FOR FREQUENCY BETWEEN EACH DISEASE CONTROL AREA.*/
-          int **FreqTestArea = (int**)malloc(sizeof(int*) * (num_simu+1)) ;
-          for (i = 0; i < num_simu+1; i++)
-          {
-              FreqTestArea[i] = (int*)malloc(sizeof(int) * dca_combination) ;
-              }
-          /*Fill testarea frequency array with 0*/
-                 for (i = 0 ; i < num_simu+1; i++)
-                 {
-                 for (j=0; j <dca_combination  ; j++)
-                  {
-                  FreqTestArea[i][j] = 0 ;
-                  }
-                  } 
+/*2.4.1 CREATE DATAFRAME FOR FREQUENCY BETWEEN EACH DISEASE CONTROL AREA.*/
+      hist.dca = (int32_t*)calloc((num_simu+1) * NUM_DCA_COMBINATIONS, sizeof(int32_t)) ;
+      rewire_set_histograms(engine, &hist);
                 
-/*2.6 . Extract the distance from the distance matrix for observed movements*/
-/*2.6.1 FILL OUT THE FREQUENCY OF BETWEEN AND WITHIN DCA MOVEMENT*/
-                  for (i=0; i < num_moves; i++)
-                   {
-         src_farm_id = (int)MoveData[i][0] ; //get source farm id.
-         des_farm_id = (int)MoveData[i][1] ; // get destination farm id
-         dis_src_des = dis_matrix[src_farm_id][des_farm_id] ;
-         
-         dis_array[dis_src_des][0] = dis_array[dis_src_des][0] + 1 ; // counter +1
-         
-         //and fill the testarea combination
-         src_testarea = (int)FarmData[src_farm_id][3] ;
-		 des_testarea = (int)FarmData[des_farm_id][3] ;
-       
-       if (src_testarea != 99 && des_testarea !=99)
-          {
-          test_area_comb = (src_testarea)*5 + des_testarea;
-          FreqTestArea[0][test_area_comb] = FreqTestArea[0][test_area_comb] + 1 ; //INCREASE THE COUNT OF GIVEN COMBINATION OF TEST AREA BY 1
-          }
-           else
-           {
-           FreqTestArea[0][dca_combination-1] = FreqTestArea[0][dca_combination-1] + 1 ; //If testarea of either src or des farm is unknown, then store at column dca_combination-1 (i.e. column 25).
-           }
+/*2.5 OPTIONAL: OPEN THE FILE OF REWIRED MOVEMENTS*/
+         struct driver_output out;
+         out.Rewired = NULL;
+         if (write_rewired == 1)
+         {
+         out.Rewired = fopen(RewiredDataFile, "w");
+         }
+         FILE *AssignCost = NULL;
+         if (config.match_engine == 1 || compare_greedy == 1)
+         {
+         AssignCost = fopen(AssignCostFile, "w");
+         if (AssignCost == NULL)
+         {
+         fprintf(stderr, "Can not open %s\n", AssignCostFile);
+         exit(1);
+         }
+         }
+         out.Unmatched = NULL;
+         if (write_unmatched == 1)
+         {
+         out.Unmatched = fopen(UnmatchedStubFile, "w");
          }
-                 printf("Making FreqTestArea done"); 
-/*2.6.2 CREATE AND READ IN THE PREDICTED DISTANCE FILES*/
-        int **CovPredData = (int**)malloc(sizeof(int*) * (num_covs)) ;
-          for (i = 0; i < num_covs; i++)
-          {
-              CovPredData[i] = (int*)malloc(sizeof(int) * num_covs_var) ;
-              }
-              printf("Making cov dataframe done"); 
-              distance_interval_data(DistanceIntervalFile, CovPredData, num_covs, num_simu) ;
 
-         printf("First line of CovPredData is %d, %d", CovPredData[0][0],CovPredData[1][0]);  
+/*2.5.1 OPTIONAL: NETWORK METRICS*/
+         out.Graph = NULL;
+         FILE *Metrics = NULL;
+         FILE *DegreeDis = NULL;
+         struct network_metrics metrics;
+         if (network_metrics == 1)
+         {
+         out.Graph = network_create(num_farms);
+         Metrics = fopen(NetworkMetricsFile, "w");
+         DegreeDis = fopen(DegreeDisFile, "w");
+         }
+
+/*2.5.2 OPTIONAL: TEMPORAL REACHABILITY*/
+         out.Reach = NULL;
+         out.reach_slot = 0;
+         int32_t *reach_size = NULL; // reach_batch x num_farms
+         int32_t *FreqReach = NULL; // num_farms rows (0 to num_farms-1 farms reached) x (num_simu+1)
+         struct reach_summary summary = {0};
+         if (temporal_reach == 1)
+         {
+         out.Reach = temporal_reach_create(num_farms, reach_batch);
+         reach_size = (int32_t*)malloc(sizeof(int32_t) * reach_batch * num_farms);
+         FreqReach = (int32_t*)calloc(num_farms * (num_simu+1), sizeof(int32_t));
+         summary.observed = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+         summary.sum = (double*)calloc(num_farms, sizeof(double));
+         summary.sum_sq = (double*)calloc(num_farms, sizeof(double));
+         summary.min = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+         summary.max = (int32_t*)calloc(num_farms, sizeof(int32_t));
+         summary.largest = 0;
+         for (i = 0; i < num_farms; i++)
+         {
+         summary.min[i] = (int32_t)num_farms;
+         }
+         }
+         rewire_match_fn on_match = (out.Rewired != NULL || out.Graph != NULL || out.Reach != NULL) ? store_rewired_move : NULL;
+         rewire_unmatched_fn on_unmatched = (out.Unmatched != NULL) ? write_unmatched_stub : NULL;
+         rewire_set_callbacks(engine, on_match, on_unmatched, &out);
+
+/*2.6 . Extract the distance from the distance matrix for observed movements, and the frequency of between and within DCA movement*/
+      if (rewire_observed(engine) != 0)
+      {
+      fprintf(stderr, "Movement file %s is not sorted by day\n", MoveDataFile);
+      exit(1);
+      }
+      if (verbosity >= 2)
+      {
+      printf("Observed movements counted\n");
+      }
+      if (out.Reach != NULL) // observed movements went to slot 0
+      {
+      temporal_reach_compute(out.Reach, 1, reach_size);
+      count_reach_sizes(reach_size, num_farms, 1, 0, FreqReach, num_simu, &summary);
+      temporal_reach_clear(out.Reach);
+      }
+/*2.7 CREATE AND READ IN THE PREDICTED DISTANCE FILES. Streamed movements read theirs day by day with them*/
+        uint16_t *CovPredData = NULL;
+        FILE *PredFile = NULL;
+        if (stream_moves == 1)
+        {
+        PredFile = fopen(PredictionFile, "rb");
+        if (rewire_set_prediction_file(engine, PredFile) != 0)
+        {
+        fprintf(stderr, "Can not use %s as the predictions of %d iterations\n", PredictionFile, num_simu);
+        exit(1);
+        }
+        }
+        else
+        {
+        CovPredData = (uint16_t*)malloc(sizeof(uint16_t) * num_covs * num_simu) ;
+              rewire_read_distance_intervals(DistanceIntervalFile, CovPredData, num_covs, num_simu) ;
+        rewire_set_predictions(engine, CovPredData, num_covs, num_simu);
+         if (verbosity >= 2)
+         {
+         printf("Predicted distances read, first line is %d, %d\n", CovPredData[0],CovPredData[num_simu]);
+         }
+        }
                
-         
-/*2.7 OPTIONAL: VISUALISE THE INWARD STUBS THAT ARE AVAILABLE On A GIVEN DAY*/
-          
-         
-
-          /* VISUALIZE ARRAY */
-                // for(i =0 ; i < num_days; i++)
-                // {
-                // visualize_list( instubs_day, i)   ; 
-                // }
-                // printf("\n\n");
-/*2.9 OPTIONAL: CREATE REWIRED MOVEMENTS*/
-      //   int **RewiredMoveData = (int**)malloc( sizeof(int *) * num_moves);
-       //   for(i = 0; i < num_moves; i++)
-        //        {
-         //       RewiredMoveData[i] = (int*)malloc( sizeof(int) * num_rewired_move_vars);  
-          //      }
 
 
 /*===============================================================================*/
      
 /*3. REWIRE ALGORITHM===========================================*/
-
-/* REWIRE STEPS.
-3.1. START LOOP A - ITERATIONS OF REWIRING OF WHOLE STUBS.
-3.2. START LOOP B - LOOP FOR EACH STUBS IN A GIVEN ITERATION.
-3.3. IDENTIFY THE BEST INSTUBS FOR EACH OUTWARD STUB. 
- 3.3.1. ON THE EXACT MOVEMENT DAY OF OUTWARD STUB.
- 3.3.2. DAYS WITHIN RANGE.
-3.4. STORE THE IDENTIFIED INSTUB INFORMATION.
-3.5. DELETE THE IDENTIFIED INSTUBS FROM THE LINKED ARRAY LIST.
-3.6. CREATE OUTPUT DATA.
-     3.6.1 CALCULATE THE DISTANCE FREQUENCY.
-     3.6.2 CALCULATE THE FREQUENCY OF BATCH BETWEEN EACH DISEASE CONTROL AREA.*/
-
-     /* INITALISATION OF VARIABLES*/
-     struct stub_node *find_node; // find_node is a pointer to a struct. Declare this before simulation iteration loop.
-     struct stub_node *best_node;
-
-     int randInt, selected_dis,dis_to_inward,dis_diff,batch_this_move,day_this_move,src_batch_type,cov_this_move,day_to_delete2 ;
-     int randInt_prob;
-     int shortest_dis;
-      unsigned int range_min = 0;
-      unsigned int prob_max = 1000;
-      int min_diff = max_dis ; //maximum distance between two farms in NZ
-       int array_ordered_day[error_range_day_movement];//in order for loop to be used for searching best farm +/- range days, make array of numbers that tells the order of searching
-        int move_id_this_move ;
-         int day_to_delete = day_this_move;
-         
-/* 3.1 Start Loop A - 1000 iterations*/
+/* 3.1 Start Loop A - 1000 iterations. Loop B and the output of each iteration run in rewire_run_iteration*/
+     struct rewire_iteration_stats stats;
+     struct rewire_iteration_stats greedy_stats; // greedy engine on the same iteration
+     struct rewire_histograms no_hist = {0}; // the greedy comparison counts nothing
+     struct progress_report report;
+     report.verbosity = verbosity;
+     report.interval = progress_interval;
+     report.total = num_simu;
+     report.start = time(NULL);
+     report.last = report.start;
 for (count_iter = 0 ; count_iter < num_simu; count_iter++) 
 
 {
-  	/* Attach a random number to each batch for random sorting*/
-        for (i = 0; i < num_moves; i++)
-        {
-        	randInt = (int)rand_interval(range_min,(unsigned int)(num_moves));
-		
-        MoveData[i][num_move_vars] = randInt;
-        }
-  	/* Reorder the movement data*/
-  	qsort(MoveData, num_moves, sizeof(MoveData[0]), comp_random);
-  	
- /* MAKE ARRAY OF POINTERS TO STUB NODE STRUCTS*/
-          struct stub_node *outstubs_day[num_days]; // a pointer to a struct
-          for(i = 0; i < num_days; i++)
-                {
-                outstubs_day[i] = NULL;
-                }
-
-          /* POPULATE THE ARRAY THAT WILL BE lINKED BY POINTERS*/ 
-          struct stub_node *new_node; // each farm struct is also a pointer to a struct   
-          for (i=0; i < num_moves; i++)
-          { 
-                /* CREATE A NEW STRUCT FOR THE OUT STUB */
-                new_node = (struct stub_node*)malloc(sizeof( struct stub_node )); 
-                new_node -> farm_id = (int)MoveData[i][0] ; /*source farm*/
-                new_node -> batch_type = (int)MoveData[i][3] ;
-                new_node -> next_node = NULL;   
-         
-                current_day = (int)MoveData[i][2] ;
-               
-                /* ADD THE NEW NODE TO THE ARRAY */
-                 add_node_to_day(outstubs_day, current_day, new_node ) ;
-                 
-           } 
-           printf("adding node done");
-
-
-/* 3.2 START OF LOOP B - one loop is one outward stub*/
-    for (batch = 0; batch < num_moves ; batch++) //batch is counter to count and look each batch from the top
-
-    { 
-        
-	best_node = NULL; // Initialise the indicator if best node is found or not
-
-        min_diff = 9999; // Initialise the minimum distance found between the outward and candidate inward to 9999, which is longer than possible between farm distance in NZ
-        shortest_dis = 9999;
-        int next_min_diff =9999;
- 
-        des_farm_id = (int)MoveData[batch][1]; 
-        batch_this_move = (int)MoveData[batch][3]; //batch type of this batch
-        day_this_move = (int)MoveData[batch][2] ; //day of movement
-      move_id_this_move = (int)MoveData[batch][4] ; //id that links this batch to the predicted distance 
-      des_testarea = (int)FarmData[des_farm_id][3] ; //testarea of destination farm
-      selected_dis = CovPredData[move_id_this_move][count_iter] ; // get the predicted distance for this batch
-      
+     if (out.Graph != NULL)
+     {
+     network_clear(out.Graph);
+     }
+     out.reach_slot = (int)(count_iter % reach_batch);
+     if (config.match_engine == 1 && compare_greedy == 1)
+     {
+     /* GREEDY RUN OF THE SAME ITERATION, WITHOUT OUTPUT, THEN THE SAME RANDOM NUMBERS FOR THE ASSIGNMENT*/
+     srand(seed + (unsigned)count_iter);
+     rewire_set_match_engine(engine, 0);
+     rewire_set_histograms(engine, &no_hist);
+     rewire_set_callbacks(engine, NULL, NULL, NULL);
+     if (rewire_run_iteration(engine, count_iter, &greedy_stats) != 0)
+     {
+     fprintf(stderr, "Movement file %s is not sorted by day or does not match the predictions\n", MoveDataFile);
+     exit(1);
+     }
+     rewire_set_match_engine(engine, 1);
+     rewire_set_histograms(engine, &hist);
+     rewire_set_callbacks(engine, on_match, on_unmatched, &out);
+     srand(seed + (unsigned)count_iter);
+     }
+     if (rewire_run_iteration(engine, count_iter, &stats) != 0)
+     {
+     fprintf(stderr, "Movement file %s is not sorted by day or does not match the predictions\n", MoveDataFile);
+     exit(1);
+     }
+     if (config.match_engine == 0)
+     {
+     greedy_stats = stats;
+     }
+     else if (compare_greedy == 0)
+     {
+     greedy_stats.matched = -1;
+     greedy_stats.cost = -1;
+     }
+     if (out.Graph != NULL)
+     {
+     network_compute(out.Graph, FarmData.testarea, reach_steps, &metrics);
+     write_network_metrics(Metrics, DegreeDis, count_iter, &metrics);
+     }
+     /* Reachability once reach_batch iterations (or the last ones) are collected*/
+     if (out.Reach != NULL && (out.reach_slot == reach_batch - 1 || count_iter == num_simu - 1))
+     {
+     temporal_reach_compute(out.Reach, out.reach_slot + 1, reach_size);
+     count_reach_sizes(reach_size, num_farms, out.reach_slot + 1, count_iter - out.reach_slot + 1, FreqReach, num_simu, &summary);
+     temporal_reach_clear(out.Reach);
+     }
+     if (AssignCost != NULL)
+     {
+     fprintf(AssignCost, "%ld,%d,%ld,%ld,%ld,%ld\n", count_iter, config.match_engine, stats.matched, stats.cost, greedy_stats.matched, greedy_stats.cost);
+     }
+     if (verbosity >= 1)
+     {
+     report_progress(&report, count_iter, &stats);
+     }
+    
      
-/* 3.3 SEARCH FOR INWARD STUBS AS FOLLOWS.
-      1. First check if there are any instubs on this day. If yes, check batch type, then their distance, get the best farm.
-      2. If the identified distance difference is not 0 (i.e. there is possibility that other inward on other candidate days can be better), then move to the other days, only if this date has inward.*/
-      find_node = outstubs_day[day_this_move]; //jump to the starting farm on a given day in outstub
-      
-     /*3.3.1. On the observed movement day*/    
-  
-      if (find_node != NULL) //if this date has inward farms
-      {
-       while(find_node != NULL)
-       {
-        if (find_node -> farm_id != des_farm_id)
-        { //if the source farm and pointed farm are different; otherwise go to next farm
-        src_batch_type = find_node -> batch_type; //Get the batch type of this inward.
-        
-        if (src_batch_type == batch_this_move) //Batch type should be the same.*****LOOP STARTS
-        { //Loop same batch
-           src_farm_id = find_node -> farm_id ; //Get the farm which is pointed now. 
-           dis_to_inward = dis_matrix[src_farm_id][des_farm_id]; //Get the distance between source and destination.
-         /*Calclulate the difference in distance between the chosen random value and dis_to_inward*/
-           dis_diff = abs(selected_dis - dis_to_inward) ;
-           /*If dis_diff is smaller than the current best distance, overwrite*/
-           if (dis_diff < min_diff) 
-              { 
-              min_diff = dis_diff;
-              best_node = find_node ; //store the pointer to this farm
-              day_to_delete = day_this_move;
-                 if (min_diff == 0)
-                 {
-                 break; 
-                 } //Once the distance diffference reaches 0, stop searching anymore       
-              }
-       
-             
-          }//Loop same batch end.
-          }//IF source!= pointed farm ends.
-          find_node = find_node -> next_node ; //go to next node
-        }//while loop ends
-       }//If statement ends; Step 1 to search the best farm on the best day done.
-       
-
-      /*3.3.2 Days within the specified range of the observed movement day*/
-       /*ONLY IF min_diff !=0*/
-       
-       if (min_diff != 0) // if min_diff is already 0 then no point of searching anymore
-       {
-          
-              for (i = 0 ; i < error_range_day_movement; i++)
-                {
-               array_ordered_day[i] = day_this_move - (i+1);
-               
-                } //making array done.
-        for (i = 0; i < error_range_day_movement; i++)
-            {//search each day below
-            search_day = array_ordered_day[i];
-            if (search_day >=0 && search_day < num_days)
-            {
-               find_node = outstubs_day[search_day]; //jump to the starting farm on a given day in instub
-               
-                         if (find_node != NULL) //if this date has inward farms
-                         {
-                                  
-                          while(find_node != NULL)
-                          {
-                          if (find_node -> farm_id != des_farm_id)
-                          {
-                          src_batch_type = find_node -> batch_type; //Get the batch type.
-        
-                                         if (src_batch_type == batch_this_move) //Batch type should be the same.*****LOOP STARTS
-                                         { //Loop same batch
-                                         src_farm_id = find_node -> farm_id ; //Get the farm which is pointed now. 
-                                         dis_to_inward = dis_matrix[src_farm_id][des_farm_id];
-                                         dis_diff = abs(selected_dis - dis_to_inward) ;
-      
-                                         if (dis_diff < min_diff) 
-                                         { 
-                                          min_diff = dis_diff;
-                                           best_node = find_node ; //store the pointer to this farm
-                                            day_to_delete = search_day; //overwrite the day from which the node is deleted.
-                                                     if (min_diff == 0)
-                                                     {
-                                                      break; 
-                                                      } //Once the distance diffference reaches 0, stop searching anymore       
-                                         }
-
-                                         }//Loop same batch end.
-                             }//IF source farm != pointed farm ends.
-                             find_node = find_node -> next_node ; //go to next node
-                           
-                           }//while loop ends
-                          }//If (find_node!=NULL) ends
-            }//If (search_day>=0 && search-day<= num_days) ends.
-
-            }//search each day ends.
-        }//Loop for Step2 to search other days ends.
-         
-
- /* 3.4. STORE THE INSTUB DATA - MAKE SURE SAVE THESE DATA BEFORE DELETING THE NODE*/        
-       if (best_node != NULL) // only if outward stubs found their partners
+} 
+  // write output files
+       if (hist_format != 1)
        {
-       src_farm_id = best_node -> farm_id ;
-       dis_src_des = dis_matrix[src_farm_id][des_farm_id];
-       dis_array[dis_src_des][count_iter+1] = dis_array[dis_src_des][count_iter+1] + 1; //INCREASE THE DISTANCE COUNTER BY 1
-       /* Age type specific counter for distance*/
-       //calf
-       if (batch_this_move==0)
+       write_freq_dis(FreqDisFile,hist.dis_all,num_rows, num_simu);
+       write_freq_dis(FreqDisFile_calf,hist.dis_calf,num_rows, num_simu);
+       write_freq_dis(FreqDisFile_heifer,hist.dis_heifer,num_rows, num_simu);
+       write_freq_dis(FreqDisFile_adult,hist.dis_adult,num_rows, num_simu);
+       write_freq_data(DCAfreqDataFile,hist.dca,num_simu,NUM_DCA_COMBINATIONS);
+       }
+       if (hist_format != 0)
        {
-       dis_array_calf[dis_src_des][count_iter+1] = dis_array_calf[dis_src_des][count_iter+1] + 1; 
+       hist_failed = hist_failed + (write_hist(FreqDisHist,scenario,"distance_km",-1,seed,hist.dis_all,num_rows,num_simu,HIST_LAYOUT_BIN_ROWS) != 0);
+       hist_failed = hist_failed + (write_hist(FreqDisHist_calf,scenario,"distance_km",0,seed,hist.dis_calf,num_rows,num_simu,HIST_LAYOUT_BIN_ROWS) != 0);
+       hist_failed = hist_failed + (write_hist(FreqDisHist_heifer,scenario,"distance_km",1,seed,hist.dis_heifer,num_rows,num_simu,HIST_LAYOUT_BIN_ROWS) != 0);
+       hist_failed = hist_failed + (write_hist(FreqDisHist_adult,scenario,"distance_km",2,seed,hist.dis_adult,num_rows,num_simu,HIST_LAYOUT_BIN_ROWS) != 0);
+       hist_failed = hist_failed + (write_hist(DCAfreqDataHist,scenario,"dca_combination",-1,seed,hist.dca,NUM_DCA_COMBINATIONS,num_simu,HIST_LAYOUT_NETWORK_ROWS) != 0);
        }
-       else if (batch_this_move==1)
+       if (out.Reach != NULL)
+       {
+       if (hist_format != 1)
        {
-       //heifer
-       dis_array_heifer[dis_src_des][count_iter+1] = dis_array_heifer[dis_src_des][count_iter+1] + 1;
+       write_freq_dis(FreqReachFile,FreqReach,summary.largest + 1, num_simu); // rows up to the largest reachability found
        }
-       else if (batch_this_move==2)
+       if (hist_format != 0)
        {
-       //adults
-       dis_array_adult[dis_src_des][count_iter+1] = dis_array_adult[dis_src_des][count_iter+1] + 1;
+       hist_failed = hist_failed + (write_hist(FreqReachHist,scenario,"farms_reached",-1,seed,FreqReach,summary.largest + 1,num_simu,HIST_LAYOUT_BIN_ROWS) != 0);
        }
-       
-       src_testarea = (int)FarmData[src_farm_id][3] ;
-       
-       if (src_testarea != 99 && des_testarea !=99) // if neither source and destination DCA is known, calculate the follwoing to get a unique DCA combination indicator
-          {
-          test_area_comb = (src_testarea)*5 + des_testarea;
-          FreqTestArea[count_iter+1][test_area_comb] = FreqTestArea[count_iter+1][test_area_comb] + 1 ; //INCREASE THE COUNTE OF GIVEN COMBINATION OF TEST AREA
-          }
-           else
-           {
-           FreqTestArea[count_iter+1][dca_combination-1] = FreqTestArea[count_iter+1][dca_combination-1] + 1 ; //If testarea of either src or des farm is unknown, then store at column dca_combination-1.
-           }
-           
+       write_reach_farm(ReachFarmFile,&FarmData,&summary,num_simu);
        }
-           
-/* 3.5. DELETE IDENTIFIED STUBS FROM THE INSTUB LISTS*/
-    find_node = outstubs_day[day_to_delete]; 
- 
-    if(find_node != NULL)
-    {
-       while(find_node != NULL)
-          {
-              if(find_node == best_node)
-                   {
-                   remove_node_from_day(outstubs_day, day_to_delete, find_node);
-                   break;
-                   }
-              else
-                  {
-                 find_node = find_node -> next_node;  
-                  }  
-          }  
-   }
-   
-   } //########################### LOOP B ENDS HERE.
-   
-
-       
-      
-      for (i = 0 ; i < num_days; i++)
-      {
-          visualize_list( outstubs_day, i);
-          }
-     printf("Iteration %d done", count_iter) ;
-    
-     
-} 
-  // write output files
-       write_freq_dis(FreqDisFile,dis_array,max_dis, num_simu);
-       write_freq_dis(FreqDisFile_calf,dis_array_calf,max_dis, num_simu);
-       write_freq_dis(FreqDisFile_heifer,dis_array_heifer,max_dis, num_simu);
-       write_freq_dis(FreqDisFile_adult,dis_array_adult,max_dis, num_simu);
-       write_freq_data(DCAfreqDataFile,FreqTestArea,num_simu,dca_combination);
 /*================================================================================*/
      
 /* 4. CLEAR DYNAMICALLY ALLOCATED MEMORY*/
-   /*Clear MoveData*/
-   for(i = 0; i < num_moves; i++)
-         { 
-   free(MoveData[i]);
-                     }
-   free(MoveData);
+   if (out.Rewired != NULL)
+   {
+   fclose(out.Rewired);
+   }
+   if (AssignCost != NULL)
+   {
+   fclose(AssignCost);
+   }
+   if (out.Unmatched != NULL)
+   {
+   fclose(out.Unmatched);
+   }
+   if (out.Reach != NULL)
+   {
+   temporal_reach_destroy(out.Reach);
+   free(reach_size);
+   free(FreqReach);
+   free(summary.observed);
+   free(summary.sum);
+   free(summary.sum_sq);
+   free(summary.min);
+   free(summary.max);
+   }
+   if (out.Graph != NULL)
+   {
+   fclose(Metrics);
+   fclose(DegreeDis);
+   network_destroy(out.Graph);
+   }
+   rewire_destroy(engine);
+   if (MoveFile != NULL)
+   {
+   fclose(MoveFile);
+   }
+   if (PredFile != NULL)
+   {
+   fclose(PredFile);
+   }
+
+   /*Clear MoveData (free(NULL) is fine in streaming mode)*/
+   free(MoveData.src_farm);
+   free(MoveData.des_farm);
+   free(MoveData.move_id);
+   free(MoveData.day);
+   free(MoveData.batch_type);
    
-   /*Clear FarmData and dis_matrix*/
-   for(i = 0; i < num_farms; i++)
-         { 
-   free(FarmData[i]);
-   free(dis_matrix[i]);
-                     }
-   free(FarmData);
-   free(dis_matrix);
+   /*Clear FarmData and CovPredData*/
+   free(FarmData.x_coord);
+   free(FarmData.y_coord);
+   free(FarmData.farm_id);
+   free(FarmData.testarea);
+   free(FarmData.island);
+   free(CovPredData);
    
-   /*Clear dis_array*/
-   for(i=0; i < max_dis; i++)
-   {
-    free(dis_array[i]) ;
-    free(dis_array_calf[i]) ;
-    free(dis_array_heifer[i]) ;
-    free(dis_array_adult[i]) ;
-    }
-    free(dis_array) ;
-    free(dis_array_calf) ;
-    free(dis_array_heifer) ;
-    free(dis_array_adult) ;
+   /*Clear the distance and DCA arrays*/
+    free(hist.dis_all) ;
+    free(hist.dis_calf) ;
+    free(hist.dis_heifer) ;
+    free(hist.dis_adult) ;
+    free(hist.dca) ;
    
 
- return(0);
+ return((hist_failed > 0) ? 1 : 0);
  }
              
              
@@ -593,314 +542,242 @@ for (count_iter = 0 ; count_iter < num_simu; count_iter++)
 /* ########################################################################## */
 /* FUNCTION CODE */
 
-/* -------------------------------------------------------------------------- */
-/* read_farm_data: READING AND PARSING CSV FARM LIST */
-/* -------------------------------------------------------------------------- */
-void read_farm_data(char FarmDataFile[], double **FarmData, long int num_farms)
-{     
-    /* OPEN INPUT FILE */
-    FILE *Farms = fopen(FarmDataFile,"r"); 
-       
-    /* DECLARE STORAGE VARIABLES */
-    long int line_num, island;
-    double x_coord, y_coord, farm_id, testarea;
-    
-    /* READ LINES OF FARM FILE */
-    for(line_num = 0; line_num < num_farms; line_num++)
-      { 
-         fscanf(Farms, "%lf,%lf,%lf, %lf, %d", &farm_id, &x_coord, &y_coord, &testarea, &island );
-
-         /* STORE VALUES IN FARM LIST */
-             FarmData[line_num][0] = farm_id;
-             FarmData[line_num][1] = x_coord;
-             FarmData[line_num][2] = y_coord;
-             FarmData[line_num][3] = testarea;
-             FarmData[line_num][4] = island;
-      }            
-   
-   /* CLOSE INPUT FILE */
-   fclose(Farms);
-   
-} 
-/* -------------------------------------------------------------------------- */
-
-/*-----------------------------------------------------------------------------*/
-/* read_movement_data: READING AND PARSING CSV Movement LIST.
-/* -------------------------------------------------------------------------- */
-void read_movement_data(char MoveDataFile[], double **MoveData, long int num_moves)
-{     
-    /* OPEN INPUT FILE */
-    FILE *Moves = fopen(MoveDataFile,"r"); 
-       
-    /* DECLARE STORAGE VARIABLES */
-    long int line_num;
-    double src_farm, des_farm, day, batch_cat, move_id;
-    
-    /* READ LINES OF FARM FILE */
-    for(line_num = 0; line_num < num_moves; line_num++)
-      { 
-         fscanf(Moves, "%lf,%lf,%lf,%lf,%lf",&src_farm, &des_farm, &day,&batch_cat,&move_id);
-
-         /* STORE VALUES IN FARM LIST */
-             MoveData[line_num][0] = src_farm;
-             MoveData[line_num][1] = des_farm;
-             MoveData[line_num][2] = day;
-             MoveData[line_num][3] = batch_cat;
-             MoveData[line_num][4] = move_id;
-
-
-      }            
-   
-   /* CLOSE INPUT FILE */
-   fclose(Moves);
-   
-} 
 /*-----------------------------------------------------------------------------*/
-
-/*-----------------------------------------------------------------------------*/
-/* Read covariate pattern that associates predicted distance.
-/* -------------------------------------------------------------------------- */
-void distance_interval_data(char DistanceIntervalFile[], int **CovPredData, int num_covs, int num_simu)
-{     
-    /* OPEN INPUT FILE */
-    FILE *DisInt = fopen(DistanceIntervalFile,"r"); 
-       
-    /* DECLARE STORAGE VARIABLES */
-    int line_num, col_num, i;
-    int **d = (int**)malloc(sizeof(int*) * (num_covs)) ;
-          for (i = 0; i < num_covs; i++)
-          {
-              d[i] = (int*)malloc(sizeof(int) * num_simu) ;
-              }
-    
-    /* READ LINES OF FARM FILE */
-    for(line_num = 0; line_num < num_covs; line_num++)
-      { 
-       for(col_num = 0; col_num < num_simu; col_num++)
-       {
-         fscanf(DisInt, "%d,", &d[line_num][col_num]); // fscanf is not reading a whole line, but only one value??
-          CovPredData[line_num][col_num] = d[line_num][col_num];
-          
-       }
-       }
-         
-   /* CLOSE INPUT FILE */
-   fclose(DisInt);
-   free(d) ;
-   
-} 
-/*-----------------------------------------------------------------------------*/
-
-
-
-/*-----------------------------------------------------------------------------*/
-/* Calculate distance between two points.
-Input is double and output is int*/
-/*-----------------------------------------------------------------------------*/
-double calc_dis(double src_x, double src_y, double des_x, double des_y)
+/*Export CSV file of the frequency of the distance*/
+/*------------------------------------------------------------------------------*/
+int write_freq_dis(char FreqDisFile[], int32_t *dis_array, long int num_rows, int num_simu)
 {
-     int distance_x_y;
-     distance_x_y = (int)(roundf(sqrt((src_x - des_x)*(src_x - des_x) + (src_y - des_y)*(src_y - des_y))/1000)) ;
-     return(distance_x_y) ;
-}
-
-/*-----------------------------------------------------------------------------*/
-
-/* -------------------------------------------------------------------------- */
-/* Sorting function*/
-/* -------------------------------------------------------------------------- */
-
-   /*Sort by random number of movements*/
-   int comp_random(const void* a, const void* b) 
-       {
-         double **p1 = (double**)a;
-         double **p2 = (double**)b;
-         double *arr1 = *p1;
-         double *arr2 = *p2;
-
-         /* SORT BY Batch_cat ASCENDING */
-        
-         int diff3 = arr1[3] - arr2[3];
-         if (diff3) return diff3;
-        /* SORT BY Day ASCENDING */
-        int diff2 = arr1[2] - arr2[2];
-        if (diff2) return diff2;
-         int diff4 = arr1[12] - arr2[12];
-         if (diff4) return diff4;
 
+	FILE *Freq = fopen(FreqDisFile,"w");
+	long int line_num, col_num;
+	
+	for (line_num = 0 ; line_num < num_rows; line_num ++)
+	{
+		for (col_num =0 ; col_num < num_simu+1; col_num++)
+		{
+		
+	 fprintf(Freq,"%d,",dis_array[line_num * (num_simu+1) + col_num]);
   }
-/* -------------------------------------------------------------------------- */     
-
-/* -------------------------------------------------------------------------- */
-/* add_stub: ADD MOVEMENT TO FARM LIST */
-/* -------------------------------------------------------------------------- */
-void add_node_to_day(struct stub_node *day_list[], int day, struct stub_node *node_to_add )
-{     
-
- struct stub_node *current_node1;
- current_node1 = day_list[day];
- if(current_node1 == NULL)
-    {
-        day_list[day] = node_to_add;
-    }
- else
-    {
-       node_to_add -> next_node = current_node1;
-       day_list[day] = node_to_add;
-    }
-
+  fprintf(Freq,"\n");
+}
+	fclose(Freq);
+	return 0;
 }
-
-/* -------------------------------------------------------------------------- */
-/* VISUALIZE INFORMATION FROM LINKED LIST ----------------------------------- */
 /* -------------------------------------------------------------------------- */
-void visualize_list(struct stub_node *day_list[], int day)  
-{
 
- 
- struct stub_node *current_node1;
- current_node1 = day_list[day];
- if(current_node1 != NULL)
-    {
-       printf("Day %d: ", day );
-       while(current_node1 != NULL)
-          {
-              printf("%d, ", current_node1 -> farm_id);
-              current_node1 = current_node1 -> next_node; 
-              
-          }  
-       printf("\n");
-   }
- 
+/*-----------------------------------------------------------------------------*/
+/*Store one rewired movement (engine callback): append it to the CSV file of the rewired data,
+add it to the graph of the network metrics and to the temporal reachability, whichever is enabled.
+Columns: iteration, source farm, destination farm, day, day of the matched stub, batch type, distance*/
+/*------------------------------------------------------------------------------*/
+void store_rewired_move(const struct rewire_match *match, void *user)
+{
+	struct driver_output *out = (struct driver_output*)user;
 
+	if (match->count_iter < 0) // observed movement, only the reachability uses it
+	{
+	if (out->Reach != NULL)
+	{
+	temporal_reach_add_edge(out->Reach, 0, match->src_farm, match->des_farm, match->day);
+	}
+	return;
+	}
+	if (out->Rewired != NULL)
+	{
+	fprintf(out->Rewired,"%ld,%d,%d,%d,%d,%d,%d\n",match->count_iter,match->src_farm,match->des_farm,match->day,match->src_day,match->batch_type,match->distance);
+	}
+	if (out->Graph != NULL)
+	{
+	network_add_edge(out->Graph, match->src_farm, match->des_farm);
+	}
+	if (out->Reach != NULL)
+	{
+	temporal_reach_add_edge(out->Reach, out->reach_slot, match->src_farm, match->des_farm, match->day);
+	}
 }
 /* -------------------------------------------------------------------------- */
 
-/*----------------------------------------------------------------------------*/
-/* RANDOM NUMBER GENERATOR FUNCTION*/
 /*-----------------------------------------------------------------------------*/
-unsigned int rand_interval(unsigned int min, unsigned int max)
+/*Write a stub that was retired without a partner (engine callback, only set with write_unmatched == 1).
+Columns: iteration, day, farm, batch type*/
+/*------------------------------------------------------------------------------*/
+void write_unmatched_stub(long int count_iter, int day, int farm_id, int batch_type, void *user)
 {
-    int r;
-    const unsigned int range = 1 + max - min;
-    const unsigned int buckets = RAND_MAX / range;
-    const unsigned int limit = buckets * range;
-    
-    do
-    { 
-        r = rand();
-    } while (r >= limit);
+	struct driver_output *out = (struct driver_output*)user;
 
-    return min + (r / buckets);
+	fprintf(out->Unmatched,"%ld,%d,%d,%d\n",count_iter,day,farm_id,batch_type);
 }
+/* -------------------------------------------------------------------------- */
 
+/*-----------------------------------------------------------------------------*/
+/*Print the progress of Loop A: every iteration with verbosity 2, otherwise once progress_interval
+seconds have passed since the last line, and after the last iteration*/
 /*------------------------------------------------------------------------------*/
-/* -------------------------------------------------------------------------- */
-/* REMOVE A NODE FROM THE LIST */
-/* -------------------------------------------------------------------------- */
-int remove_node_from_day(struct stub_node *day_list[], int day, struct stub_node *node_to_remove)
+void report_progress(struct progress_report *report, long int count_iter, const struct rewire_iteration_stats *stats)
 {
-  
-  if (day_list[day] != NULL)
-  {
-    struct stub_node *prev_node1;
-    struct stub_node *current_node1;
-  
-    prev_node1 = day_list[day];
-    current_node1 = day_list[day];
-    while(current_node1 != NULL)
-      {
-         if(current_node1 == node_to_remove)
-           {
-                if(current_node1 == day_list[day])
-                 {
-                    day_list[day] = current_node1 -> next_node;
-                    free(current_node1);
-                    return (0);
-                 }
-                else
-                 {
-                  prev_node1 -> next_node = current_node1 -> next_node;                   
-                  free(current_node1);
-                  return (0);
-
-                 }
-           }
-         else
-           {
-              prev_node1 = current_node1;
-              current_node1 = current_node1 -> next_node;  
-           }
-      }            
-
-      return (0);
-   }
-   
-   return (0);
+	time_t now = time(NULL);
+	double elapsed, eta;
+	long int done = count_iter + 1;
+
+	if (report->verbosity < 2 && difftime(now, report->last) < report->interval && done < report->total)
+	{
+	return;
+	}
+	report->last = now;
+	elapsed = difftime(now, report->start);
+	eta = elapsed / done * (report->total - done);
+	printf("Iteration %ld/%ld done, %ld unmatched, %ld buckets skipped, %.0f s elapsed, ETA %.0f s\n",
+	       done, report->total, stats->unmatched, stats->skipped, elapsed, eta);
+	fflush(stdout);
 }
 /* -------------------------------------------------------------------------- */
 
 /*-----------------------------------------------------------------------------*/
-/*Export CSV file of the frequency of the distance*/
+/*Export CSV file of the DCA frequency data*/
 /*------------------------------------------------------------------------------*/
-int write_freq_dis(char FreqDisFile[],int **dis_array, int max_dis, int num_simu)
+int write_freq_data(char DCAfreqDataFile[], int32_t *FreqTestArea, int num_simu, int dca_combination)
 {
 
-	FILE *Freq = fopen(FreqDisFile,"w");
+	FILE *DCAfreq = fopen(DCAfreqDataFile,"w");
 	int line_num, col_num;
 	
-	for (line_num = 0 ; line_num < max_dis; line_num ++)
+	for (line_num = 0 ; line_num < num_simu+1; line_num ++)
 	{
-		for (col_num =0 ; col_num < num_simu+1; col_num++)
+		for (col_num = 0;col_num <dca_combination ; col_num++ )
+		
 		{
 		
-	 fprintf(Freq,"%d,",dis_array[line_num][col_num]);
+	 fprintf(DCAfreq,"%d,",FreqTestArea[line_num * dca_combination + col_num]);
   }
-  fprintf(Freq,"\n");
+  fprintf(DCAfreq,"\n");
 }
-	fclose(Freq);
+	fclose(DCAfreq);
 	return 0;
 }
+/* -------------------------------------------------------------------------- */
+
 /*-----------------------------------------------------------------------------*/
+/*Export a histogram as a compressed binary file, network 0 observed then iterations 0 .. num_simu-1.
+Returns 0, -1 (reported on stderr) if the file can not be written.
+BIN_ROWS tables are laid out like FreqDisFile (bin * (num_simu+1) + network),
+NETWORK_ROWS tables like DCAfreqDataFile (network * num_bins + bin)*/
+/*------------------------------------------------------------------------------*/
+int write_hist(char HistFile[], char scenario[], char quantity[], int batch_type, unsigned int seed, int32_t *table, long int num_bins, int num_simu, int layout)
+{
+	struct hist_meta meta;
+	long int bin_stride = (layout == HIST_LAYOUT_BIN_ROWS) ? num_simu + 1 : 1;
+	long int network_stride = (layout == HIST_LAYOUT_BIN_ROWS) ? 1 : num_bins;
+
+	memset(&meta, 0, sizeof(meta));
+	meta.layout = layout;
+	meta.num_bins = num_bins;
+	meta.num_networks = num_simu + 1;
+	meta.has_observed = 1;
+	meta.first_iter = 0;
+	meta.last_iter = num_simu - 1;
+	meta.batch_type = batch_type;
+	meta.seed = seed;
+	strncpy(meta.scenario, scenario, sizeof(meta.scenario) - 1);
+	strncpy(meta.quantity, quantity, sizeof(meta.quantity) - 1);
+	if (write_hist_file(HistFile, &meta, table, bin_stride, network_stride) != 0)
+	{
+	fprintf(stderr, "Can not write %s\n", HistFile);
+	return (-1);
+	}
+	return (0);
+}
+/* -------------------------------------------------------------------------- */
 
 /*-----------------------------------------------------------------------------*/
-/*Export CSV file of the rewired data*/
+/*Append the network metrics of one iteration: one line to the metrics file and
+one line per degree (up to the largest in or out degree) to the degree distribution file*/
 /*------------------------------------------------------------------------------*/
-int write_rewired_data(char RewiredDataFile[],int **RewiredMoveData, int num_moves)
+void write_network_metrics(FILE *Metrics, FILE *DegreeDis, long int count_iter, const struct network_metrics *metrics)
 {
+	int d, max_degree;
 
-	FILE *Rewired = fopen(RewiredDataFile,"w");
-	int line_num;
-	
-	for (line_num = 0 ; line_num < num_moves; line_num ++)
+	fprintf(Metrics,"%ld,%ld,%ld,%ld,%d,%d,%f,",count_iter,metrics->num_edges,metrics->num_links,metrics->active_farms,
+	        metrics->max_out_degree,metrics->max_in_degree,metrics->mean_degree);
+	for (d = 0; d < NUM_DCA_CODES; d++)
 	{
-	 fprintf(Rewired,"%d, %d, %d,%d,%d,%d\n",RewiredMoveData[line_num][0],RewiredMoveData[line_num][1],RewiredMoveData[line_num][2],RewiredMoveData[line_num][3],RewiredMoveData[line_num][5],RewiredMoveData[line_num][8] );
-  }
-	fclose(Rewired);
-	return 0;
+	fprintf(Metrics,"%ld,",metrics->out_strength_dca[d]);
+	}
+	for (d = 0; d < NUM_DCA_CODES; d++)
+	{
+	fprintf(Metrics,"%ld,",metrics->in_strength_dca[d]);
+	}
+	fprintf(Metrics,"%ld,%ld,%f,%ld\n",metrics->largest_scc,metrics->largest_wcc,metrics->mean_reach,metrics->max_reach);
+
+	max_degree = (metrics->max_out_degree > metrics->max_in_degree) ? metrics->max_out_degree : metrics->max_in_degree;
+	for (d = 0; d <= max_degree; d++)
+	{
+	fprintf(DegreeDis,"%ld,%d,%d,%d\n",count_iter,d,metrics->out_degree_dis[d],metrics->in_degree_dis[d]);
+	}
 }
 /* -------------------------------------------------------------------------- */
 
 /*-----------------------------------------------------------------------------*/
-/*Export CSV file of the DCA frequency data*/
+/*Add the reachability sizes of num_slots networks to columns first_column.. of FreqReach
+and, for the rewired networks (column > 0), to the per-farm summary*/
 /*------------------------------------------------------------------------------*/
-int write_freq_data(char DCAfreqDataFile[],int **FreqTestArea, int num_simu, int dca_combination)
+void count_reach_sizes(const int32_t *reach_size, long int num_farms, int num_slots, long int first_column, int32_t *FreqReach, int num_simu, struct reach_summary *summary)
 {
+	long int farm, column;
+	int slot;
+	int32_t r;
 
-	FILE *DCAfreq = fopen(DCAfreqDataFile,"w");
-	int line_num, col_num;
-	
-	for (line_num = 0 ; line_num < num_simu+1; line_num ++)
+	for (slot = 0; slot < num_slots; slot++)
 	{
-		for (col_num = 0;col_num <dca_combination ; col_num++ )
-		
+		column = first_column + slot;
+		for (farm = 0; farm < num_farms; farm++)
 		{
-		
-	 fprintf(DCAfreq,"%d,",FreqTestArea[line_num][col_num]);
-  }
-  fprintf(DCAfreq,"\n");
+		r = reach_size[slot * num_farms + farm];
+		FreqReach[r * (num_simu+1) + column]++;
+		if (r > summary->largest)
+		{
+		summary->largest = r;
+		}
+		if (column == 0)
+		{
+		summary->observed[farm] = r;
+		continue;
+		}
+		summary->sum[farm] = summary->sum[farm] + r;
+		summary->sum_sq[farm] = summary->sum_sq[farm] + (double)r * r;
+		if (r < summary->min[farm])
+		{
+		summary->min[farm] = r;
+		}
+		if (r > summary->max[farm])
+		{
+		summary->max[farm] = r;
+		}
+		}
+	}
 }
-	fclose(DCAfreq);
+/* -------------------------------------------------------------------------- */
+
+/*-----------------------------------------------------------------------------*/
+/*Export CSV file of the reachability of each farm: farm id, observed, mean, sd, min, max over the iterations*/
+/*------------------------------------------------------------------------------*/
+int write_reach_farm(char ReachFarmFile[], const struct farm_table *FarmData, const struct reach_summary *summary, int num_simu)
+{
+
+	FILE *Reach = fopen(ReachFarmFile,"w");
+	long int farm;
+	double mean, var;
+	
+	for (farm = 0 ; farm < FarmData->num_farms; farm ++)
+	{
+	mean = summary->sum[farm] / num_simu;
+	var = summary->sum_sq[farm] / num_simu - mean * mean;
+	if (var < 0)
+	{
+	var = 0;
+	}
+	fprintf(Reach,"%d,%d,%f,%f,%d,%d\n",FarmData->farm_id[farm],summary->observed[farm],mean,sqrt(var),summary->min[farm],summary->max[farm]);
+}
+	fclose(Reach);
 	return 0;
 }
 /* -------------------------------------------------------------------------- */
@@ -0,0 +1,352 @@
+/*------------------------------------------------------------------------------*/
+/* Columnar binary file of the result histograms.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Writer used by the driver and reader used by the tools in tools/. The file
+layout is described in histogram_file.h. */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "histogram_file.h"
+
+#define HIST_MAGIC "RWHIST1"
+#define HIST_VERSION 1
+#define HIST_DIR_ENTRY_BYTES 24 // offset, bytes, codec, reserved
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+static long int put_varint(uint8_t *out, uint32_t v);
+static uint32_t zigzag(int32_t v);
+static int32_t unzigzag(uint32_t v);
+static long int encode_column(const int32_t *table, long int bin_stride, int64_t num_bins, int codec, uint8_t *out);
+static int write_meta(FILE *Hist, const struct hist_meta *meta);
+static int read_meta(FILE *Hist, struct hist_meta *meta);
+
+
+/* ########################################################################## */
+/* FUNCTION CODE */
+
+/* -------------------------------------------------------------------------- */
+/* VARINT CODING: 7 bits per byte, lowest first, high bit set on all but the last byte.
+Deltas are zigzag coded first so small negative steps stay short. */
+/* -------------------------------------------------------------------------- */
+static long int put_varint(uint8_t *out, uint32_t v)
+{
+  long int n = 0;
+
+  while (v >= 0x80)
+     {
+        out[n++] = (uint8_t)(v | 0x80);
+        v = v >> 7;
+     }
+  out[n++] = (uint8_t)v;
+  return (n);
+}
+
+static uint32_t zigzag(int32_t v)
+{
+  return (((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+  return ((int32_t)(v >> 1) ^ -(int32_t)(v & 1));
+}
+
+/* Encode one network; returns the number of bytes written to out (at most 5 per bin)*/
+static long int encode_column(const int32_t *table, long int bin_stride, int64_t num_bins, int codec, uint8_t *out)
+{
+  long int b, n = 0;
+  int32_t previous = 0, value;
+
+  for (b = 0; b < num_bins; b++)
+     {
+        value = table[b * bin_stride];
+        if (codec == HIST_CODEC_DELTA)
+           {
+              n = n + put_varint(out + n, zigzag((int32_t)((uint32_t)value - (uint32_t)previous)));
+              previous = value;
+           }
+        else
+           {
+              n = n + put_varint(out + n, (uint32_t)value);
+           }
+     }
+  return (n);
+}
+
+/* -------------------------------------------------------------------------- */
+/* HEADER, FIELD BY FIELD IN THE ORDER OF histogram_file.h */
+/* -------------------------------------------------------------------------- */
+static int write_meta(FILE *Hist, const struct hist_meta *meta)
+{
+  char magic[8] = HIST_MAGIC;
+  int ok = 1;
+
+  ok = ok && fwrite(magic, 1, sizeof(magic), Hist) == sizeof(magic);
+  ok = ok && fwrite(&meta->version, sizeof(meta->version), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->layout, sizeof(meta->layout), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->num_bins, sizeof(meta->num_bins), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->num_networks, sizeof(meta->num_networks), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->has_observed, sizeof(meta->has_observed), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->first_iter, sizeof(meta->first_iter), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->last_iter, sizeof(meta->last_iter), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->batch_type, sizeof(meta->batch_type), 1, Hist) == 1;
+  ok = ok && fwrite(&meta->seed, sizeof(meta->seed), 1, Hist) == 1;
+  ok = ok && fwrite(meta->scenario, 1, sizeof(meta->scenario), Hist) == sizeof(meta->scenario);
+  ok = ok && fwrite(meta->quantity, 1, sizeof(meta->quantity), Hist) == sizeof(meta->quantity);
+  return (ok ? 0 : -1);
+}
+
+static int read_meta(FILE *Hist, struct hist_meta *meta)
+{
+  char magic[8];
+  int ok = 1;
+
+  ok = ok && fread(magic, 1, sizeof(magic), Hist) == sizeof(magic) && memcmp(magic, HIST_MAGIC, sizeof(magic)) == 0;
+  ok = ok && fread(&meta->version, sizeof(meta->version), 1, Hist) == 1 && meta->version == HIST_VERSION;
+  ok = ok && fread(&meta->layout, sizeof(meta->layout), 1, Hist) == 1;
+  ok = ok && fread(&meta->num_bins, sizeof(meta->num_bins), 1, Hist) == 1;
+  ok = ok && fread(&meta->num_networks, sizeof(meta->num_networks), 1, Hist) == 1;
+  ok = ok && fread(&meta->has_observed, sizeof(meta->has_observed), 1, Hist) == 1;
+  ok = ok && fread(&meta->first_iter, sizeof(meta->first_iter), 1, Hist) == 1;
+  ok = ok && fread(&meta->last_iter, sizeof(meta->last_iter), 1, Hist) == 1;
+  ok = ok && fread(&meta->batch_type, sizeof(meta->batch_type), 1, Hist) == 1;
+  ok = ok && fread(&meta->seed, sizeof(meta->seed), 1, Hist) == 1;
+  ok = ok && fread(meta->scenario, 1, sizeof(meta->scenario), Hist) == sizeof(meta->scenario);
+  ok = ok && fread(meta->quantity, 1, sizeof(meta->quantity), Hist) == sizeof(meta->quantity);
+  ok = ok && meta->num_bins >= 0 && meta->num_networks >= 0;
+  if (ok)
+     {
+        meta->scenario[sizeof(meta->scenario) - 1] = '\0';
+        meta->quantity[sizeof(meta->quantity) - 1] = '\0';
+     }
+  return (ok ? 0 : -1);
+}
+
+/* -------------------------------------------------------------------------- */
+/* write_hist_file: WRITE THE HEADER, A DIRECTORY PLACEHOLDER, THE COLUMNS, THEN THE DIRECTORY */
+/* -------------------------------------------------------------------------- */
+int write_hist_file(char HistFile[], const struct hist_meta *meta, const int32_t *table, long int bin_stride, long int network_stride)
+{
+  FILE *Hist = fopen(HistFile, "wb");
+  struct hist_meta header = *meta;
+  uint8_t *plain, *delta;
+  uint64_t *col_offset, *col_bytes;
+  uint32_t *col_codec, reserved = 0;
+  long int n, plain_bytes, delta_bytes, dir_start;
+  int ok;
+
+  if (Hist == NULL)
+     {
+        return (-1);
+     }
+  header.version = HIST_VERSION;
+  ok = (write_meta(Hist, &header) == 0);
+  dir_start = ftell(Hist);
+
+  plain = (uint8_t*)malloc(5 * (header.num_bins + 1));
+  delta = (uint8_t*)malloc(5 * (header.num_bins + 1));
+  col_offset = (uint64_t*)malloc(sizeof(uint64_t) * (header.num_networks + 1));
+  col_bytes = (uint64_t*)malloc(sizeof(uint64_t) * (header.num_networks + 1));
+  col_codec = (uint32_t*)malloc(sizeof(uint32_t) * (header.num_networks + 1));
+
+  /* COLUMNS START AFTER THE DIRECTORY; EACH TAKES THE SHORTER CODING*/
+  fseek(Hist, dir_start + HIST_DIR_ENTRY_BYTES * header.num_networks, SEEK_SET);
+  for (n = 0; n < header.num_networks && ok; n++)
+     {
+        plain_bytes = encode_column(table + n * network_stride, bin_stride, header.num_bins, HIST_CODEC_VARINT, plain);
+        delta_bytes = encode_column(table + n * network_stride, bin_stride, header.num_bins, HIST_CODEC_DELTA, delta);
+        col_offset[n] = (uint64_t)ftell(Hist);
+        if (delta_bytes < plain_bytes)
+           {
+              col_codec[n] = HIST_CODEC_DELTA;
+              col_bytes[n] = (uint64_t)delta_bytes;
+              ok = fwrite(delta, 1, delta_bytes, Hist) == (size_t)delta_bytes;
+           }
+        else
+           {
+              col_codec[n] = HIST_CODEC_VARINT;
+              col_bytes[n] = (uint64_t)plain_bytes;
+              ok = fwrite(plain, 1, plain_bytes, Hist) == (size_t)plain_bytes;
+           }
+     }
+
+  /* DIRECTORY*/
+  fseek(Hist, dir_start, SEEK_SET);
+  for (n = 0; n < header.num_networks && ok; n++)
+     {
+        ok = fwrite(&col_offset[n], sizeof(uint64_t), 1, Hist) == 1 && fwrite(&col_bytes[n], sizeof(uint64_t), 1, Hist) == 1
+             && fwrite(&col_codec[n], sizeof(uint32_t), 1, Hist) == 1 && fwrite(&reserved, sizeof(uint32_t), 1, Hist) == 1;
+     }
+  if (fclose(Hist) != 0)
+     {
+        ok = 0;
+     }
+  free(plain);
+  free(delta);
+  free(col_offset);
+  free(col_bytes);
+  free(col_codec);
+  return (ok ? 0 : -1);
+}
+
+/* -------------------------------------------------------------------------- */
+/* hist_open: READ THE HEADER AND THE DIRECTORY */
+/* -------------------------------------------------------------------------- */
+int hist_open(char HistFile[], struct hist_file *hist)
+{
+  long int n;
+  uint32_t reserved;
+  int ok;
+
+  memset(hist, 0, sizeof(*hist));
+  hist->file = fopen(HistFile, "rb");
+  if (hist->file == NULL)
+     {
+        return (-1);
+     }
+  ok = (read_meta(hist->file, &hist->meta) == 0);
+  if (ok)
+     {
+        hist->col_offset = (uint64_t*)malloc(sizeof(uint64_t) * (hist->meta.num_networks + 1));
+        hist->col_bytes = (uint64_t*)malloc(sizeof(uint64_t) * (hist->meta.num_networks + 1));
+        hist->col_codec = (uint32_t*)malloc(sizeof(uint32_t) * (hist->meta.num_networks + 1));
+     }
+  for (n = 0; n < hist->meta.num_networks && ok; n++)
+     {
+        ok = fread(&hist->col_offset[n], sizeof(uint64_t), 1, hist->file) == 1 && fread(&hist->col_bytes[n], sizeof(uint64_t), 1, hist->file) == 1
+             && fread(&hist->col_codec[n], sizeof(uint32_t), 1, hist->file) == 1 && fread(&reserved, sizeof(uint32_t), 1, hist->file) == 1;
+     }
+  if (!ok)
+     {
+        hist_close(hist);
+        return (-1);
+     }
+  return (0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* hist_read_column: DECODE BINS first_bin .. last_bin OF ONE NETWORK */
+/* -------------------------------------------------------------------------- */
+int hist_read_column(struct hist_file *hist, long int network, long int first_bin, long int last_bin, int32_t *values)
+{
+  uint64_t bytes, pos = 0;
+  uint32_t v;
+  int32_t value = 0;
+  long int b;
+  int shift;
+
+  if (network < 0 || network >= hist->meta.num_networks || first_bin < 0 || last_bin >= hist->meta.num_bins || first_bin > last_bin)
+     {
+        return (-1);
+     }
+  /* A varint is at most 5 bytes, so the bins up to last_bin are within the first 5*(last_bin+1) bytes*/
+  bytes = hist->col_bytes[network];
+  if (bytes > 5 * (uint64_t)(last_bin + 1))
+     {
+        bytes = 5 * (uint64_t)(last_bin + 1);
+     }
+  if (bytes > hist->buf_capacity)
+     {
+        hist->buf_capacity = bytes;
+        hist->buf = (uint8_t*)realloc(hist->buf, bytes);
+     }
+  if (fseek(hist->file, (long int)hist->col_offset[network], SEEK_SET) != 0 || fread(hist->buf, 1, bytes, hist->file) != bytes)
+     {
+        return (-1);
+     }
+
+  for (b = 0; b <= last_bin; b++)
+     {
+        v = 0;
+        shift = 0;
+        do
+           {
+              if (pos >= bytes)
+                 {
+                    return (-1); // column shorter than num_bins
+                 }
+              v = v | (uint32_t)(hist->buf[pos] & 0x7F) << shift;
+              shift = shift + 7;
+           }
+        while (hist->buf[pos++] & 0x80);
+        value = (hist->col_codec[network] == HIST_CODEC_DELTA) ? (int32_t)((uint32_t)value + (uint32_t)unzigzag(v)) : (int32_t)v;
+        if (b >= first_bin)
+           {
+              values[b - first_bin] = value;
+           }
+     }
+  return (0);
+}
+
+/* Network (column) holding iteration iter, -1 (observed) included*/
+long int hist_network_of_iter(const struct hist_meta *meta, long int iter)
+{
+  if (iter == -1)
+     {
+        return ((meta->has_observed == 1) ? 0 : -1);
+     }
+  if (iter < meta->first_iter || iter > meta->last_iter)
+     {
+        return (-1);
+     }
+  return (meta->has_observed + iter - meta->first_iter);
+}
+
+/* -------------------------------------------------------------------------- */
+/* hist_write_csv: THE CSV OF THE DRIVER, BYTE FOR BYTE: every value followed by a comma.
+HIST_LAYOUT_BIN_ROWS as write_freq_dis (one row per bin), HIST_LAYOUT_NETWORK_ROWS
+as write_freq_data (one row per network) */
+/* -------------------------------------------------------------------------- */
+int hist_write_csv(FILE *Csv, uint32_t layout, const int32_t *table, long int num_bins, long int num_networks)
+{
+  long int b, n;
+
+  if (layout == HIST_LAYOUT_BIN_ROWS)
+     {
+        for (b = 0; b < num_bins; b++)
+           {
+              for (n = 0; n < num_networks; n++)
+                 {
+                    fprintf(Csv, "%d,", table[n * num_bins + b]);
+                 }
+              fprintf(Csv, "\n");
+           }
+     }
+  else
+     {
+        for (n = 0; n < num_networks; n++)
+           {
+              for (b = 0; b < num_bins; b++)
+                 {
+                    fprintf(Csv, "%d,", table[n * num_bins + b]);
+                 }
+              fprintf(Csv, "\n");
+           }
+     }
+  return (ferror(Csv) ? -1 : 0);
+}
+
+void hist_close(struct hist_file *hist)
+{
+  if (hist->file != NULL)
+     {
+        fclose(hist->file);
+     }
+  free(hist->col_offset);
+  free(hist->col_bytes);
+  free(hist->col_codec);
+  free(hist->buf);
+  memset(hist, 0, sizeof(*hist));
+}
+/* -------------------------------------------------------------------------- */
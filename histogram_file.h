@@ -0,0 +1,75 @@
+/*------------------------------------------------------------------------------*/
+/* Columnar binary file of the result histograms.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+A histogram table holds num_bins bins (km of distance, DCA combination, farms
+reached) for num_networks networks: the observed one (if has_observed) then
+the iterations first_iter .. last_iter. Each network is stored as its own
+compressed column, so one network, or the first bins of it, can be read
+without decoding the rest.
+
+File layout (native byte order, little-endian on the usual machines):
+  char magic[8] = "RWHIST1";
+  header: version, layout, num_bins, num_networks, has_observed, first_iter,
+          last_iter, batch_type, seed, scenario[64], quantity[32]
+  directory: per network {uint64 offset; uint64 bytes; uint32 codec; uint32 reserved}
+  column data: varints, of the values (HIST_CODEC_VARINT) or of the zigzag
+          deltas between neighbouring bins (HIST_CODEC_DELTA), whichever is shorter
+layout tells how the CSV output of the driver is laid out: HIST_LAYOUT_BIN_ROWS
+is FreqDisFile (one row per bin, one column per network), HIST_LAYOUT_NETWORK_ROWS
+is DCAfreqDataFile (one row per network). Both end every value with a comma. */
+/*------------------------------------------------------------------------------*/
+#ifndef HISTOGRAM_FILE_H
+#define HISTOGRAM_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HIST_LAYOUT_BIN_ROWS 0
+#define HIST_LAYOUT_NETWORK_ROWS 1
+#define HIST_CODEC_VARINT 0
+#define HIST_CODEC_DELTA 1
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */
+
+  struct hist_meta {
+      uint32_t version;
+      uint32_t layout;       // HIST_LAYOUT_*
+      int64_t num_bins;
+      int64_t num_networks;
+      int32_t has_observed;  // 1: network 0 is the observed data
+      int32_t first_iter;    // iteration of network has_observed
+      int32_t last_iter;
+      int32_t batch_type;    // -1 all batches, 0 calf, 1 heifer, 2 adult
+      uint64_t seed;         // seed given to srand
+      char scenario[64];
+      char quantity[32];     // what a bin counts, e.g. "distance_km"
+   };
+
+  /* An open file: the header and the column directory, columns are read on demand*/
+  struct hist_file {
+      FILE *file;
+      struct hist_meta meta;
+      uint64_t *col_offset;
+      uint64_t *col_bytes;
+      uint32_t *col_codec;
+      uint8_t *buf;          // bytes of the column being decoded
+      uint64_t buf_capacity;
+   };
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+/* Value of bin b in network n is table[b * bin_stride + n * network_stride]. Returns 0, -1 on error*/
+int write_hist_file(char HistFile[], const struct hist_meta *meta, const int32_t *table, long int bin_stride, long int network_stride);
+
+int hist_open(char HistFile[], struct hist_file *hist); // returns 0, -1 on error
+/* Bins first_bin .. last_bin of network into values[0 ..]; only the start of the column up to last_bin is decoded. Returns 0, -1 on error*/
+int hist_read_column(struct hist_file *hist, long int network, long int first_bin, long int last_bin, int32_t *values);
+long int hist_network_of_iter(const struct hist_meta *meta, long int iter); // iteration -1 is the observed network; -1 if not in the file
+/* Write table (network n at table[n * num_bins]) as the driver writes its CSV in this layout. Returns 0, -1 on error*/
+int hist_write_csv(FILE *Csv, uint32_t layout, const int32_t *table, long int num_bins, long int num_networks);
+void hist_close(struct hist_file *hist);
+
+#endif
@@ -0,0 +1,714 @@
+/*------------------------------------------------------------------------------*/
+/* Network metrics of a rewired network.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Edges are kept as two columns and turned into CSR form (rows of destination
+farms per source farm) by a counting sort. Rows are then sorted and duplicate
+links removed, so the degree counts partner farms and the strength counts
+batches. All buffers only grow and are reused between iterations. */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "network_metrics.h"
+
+#define REACH_WORDS 4 // 64-bit words per farm and source block, so a block holds 256 sources
+#define REACH_BLOCK (64 * REACH_WORDS)
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */
+  struct network_graph {
+      long int num_farms;
+      long int num_edges, cap_edges;
+      int32_t *edge_src;     // one entry per batch
+      int32_t *edge_des;
+      long int *out_start;   // num_farms + 1: row of farm i is out_adj[out_start[i] .. out_start[i+1]-1]
+      int32_t *out_adj;      // destinations of all batches, grouped by source
+      long int *row_count;   // scratch per farm
+      long int *link_start;  // num_farms + 1: distinct links, CSR by source
+      int32_t *link_adj;
+      long int *in_start;    // num_farms + 1: distinct links, CSR by destination
+      int32_t *in_adj;
+      int32_t *out_strength; // batches per farm
+      int32_t *in_strength;
+      int32_t *out_degree_dis; // num_farms + 1
+      int32_t *in_degree_dis;
+      int32_t *parent;       // union-find for the weakly connected components
+      int32_t *comp_size;
+      int32_t *scc_index;    // Tarjan's algorithm for the strongly connected components
+      int32_t *scc_low;
+      int32_t *scc_stack;
+      int32_t *call_node;
+      long int *call_pos;
+      char *on_stack;
+   };
+
+  /* Movements of one iteration for the temporal reachability, sorted by day before solving*/
+  struct reach_slot {
+      long int num_edges, cap_edges;
+      int32_t *src, *des, *day;
+      int32_t *sorted_src, *sorted_des; // by day
+      long int max_day_edges; // most movements on one day
+   };
+
+  struct temporal_reach {
+      long int num_farms;
+      int num_slots;
+      struct reach_slot *slots;
+      long int cap_days;
+      long int *day_count; // scratch of the counting sort
+   };
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+static int comp_int32(const void *a, const void *b);
+static int32_t find_root(int32_t *parent, int32_t v);
+static void build_csr(struct network_graph *g);
+static long int largest_wcc(struct network_graph *g);
+static long int largest_scc(struct network_graph *g);
+static void count_reach(struct network_graph *g, int reach_steps, double *mean_reach, long int *max_reach);
+static void sort_reach_slot(struct temporal_reach *tr, struct reach_slot *slot);
+static void reach_block(const struct reach_slot *slot, long int num_farms, long int first_source, uint64_t *words, uint64_t *day_buf, int32_t *reach_size);
+static int lowest_bit(uint64_t w);
+
+
+/* ########################################################################## */
+/* FUNCTION CODE */
+
+/* -------------------------------------------------------------------------- */
+/* network_create: ALLOCATE THE PER-FARM BUFFERS; EDGE BUFFERS GROW AS EDGES ARE ADDED */
+/* -------------------------------------------------------------------------- */
+struct network_graph *network_create(long int num_farms)
+{
+  struct network_graph *g = (struct network_graph*)calloc(1, sizeof(struct network_graph));
+
+  g->num_farms = num_farms;
+  g->out_start = (long int*)malloc(sizeof(long int) * (num_farms + 1));
+  g->row_count = (long int*)malloc(sizeof(long int) * (num_farms + 1));
+  g->link_start = (long int*)malloc(sizeof(long int) * (num_farms + 1));
+  g->in_start = (long int*)malloc(sizeof(long int) * (num_farms + 1));
+  g->out_strength = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->in_strength = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->out_degree_dis = (int32_t*)malloc(sizeof(int32_t) * (num_farms + 1));
+  g->in_degree_dis = (int32_t*)malloc(sizeof(int32_t) * (num_farms + 1));
+  g->parent = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->comp_size = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->scc_index = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->scc_low = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->scc_stack = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->call_node = (int32_t*)malloc(sizeof(int32_t) * num_farms);
+  g->call_pos = (long int*)malloc(sizeof(long int) * num_farms);
+  g->on_stack = (char*)malloc(sizeof(char) * num_farms);
+  return (g);
+}
+
+void network_clear(struct network_graph *g)
+{
+  g->num_edges = 0;
+}
+
+void network_add_edge(struct network_graph *g, int src_farm, int des_farm)
+{
+  if (g->num_edges == g->cap_edges)
+     {
+        g->cap_edges = (g->cap_edges == 0) ? 1024 : g->cap_edges * 2;
+        g->edge_src = (int32_t*)realloc(g->edge_src, sizeof(int32_t) * g->cap_edges);
+        g->edge_des = (int32_t*)realloc(g->edge_des, sizeof(int32_t) * g->cap_edges);
+        g->out_adj = (int32_t*)realloc(g->out_adj, sizeof(int32_t) * g->cap_edges);
+        g->link_adj = (int32_t*)realloc(g->link_adj, sizeof(int32_t) * g->cap_edges);
+        g->in_adj = (int32_t*)realloc(g->in_adj, sizeof(int32_t) * g->cap_edges);
+     }
+  g->edge_src[g->num_edges] = (int32_t)src_farm;
+  g->edge_des[g->num_edges] = (int32_t)des_farm;
+  g->num_edges++;
+}
+
+/* -------------------------------------------------------------------------- */
+/* network_compute: BUILD THE CSR GRAPH OF THE EDGES ADDED SINCE network_clear AND FILL metrics */
+/* -------------------------------------------------------------------------- */
+void network_compute(struct network_graph *g, const uint8_t *testarea, int reach_steps, struct network_metrics *metrics)
+{
+  long int n = g->num_farms;
+  long int i, e;
+  int d, out_degree, in_degree;
+
+  memset(metrics, 0, sizeof(*metrics));
+  build_csr(g);
+
+  /* STRENGTH PER FARM AND BY DCA*/
+  memset(g->out_strength, 0, sizeof(int32_t) * n);
+  memset(g->in_strength, 0, sizeof(int32_t) * n);
+  for (e = 0; e < g->num_edges; e++)
+     {
+        g->out_strength[g->edge_src[e]]++;
+        g->in_strength[g->edge_des[e]]++;
+     }
+
+  /* DEGREE DISTRIBUTIONS*/
+  memset(g->out_degree_dis, 0, sizeof(int32_t) * (n + 1));
+  memset(g->in_degree_dis, 0, sizeof(int32_t) * (n + 1));
+  for (i = 0; i < n; i++)
+     {
+        out_degree = (int)(g->link_start[i+1] - g->link_start[i]);
+        in_degree = (int)(g->in_start[i+1] - g->in_start[i]);
+        g->out_degree_dis[out_degree]++;
+        g->in_degree_dis[in_degree]++;
+        if (out_degree > metrics->max_out_degree)
+           {
+              metrics->max_out_degree = out_degree;
+           }
+        if (in_degree > metrics->max_in_degree)
+           {
+              metrics->max_in_degree = in_degree;
+           }
+        if (g->out_strength[i] > 0 || g->in_strength[i] > 0)
+           {
+              metrics->active_farms++;
+           }
+        d = (testarea[i] <= 4) ? testarea[i] : NUM_DCA_CODES - 1; // unknown (99) as 5
+        metrics->out_strength_dca[d] += g->out_strength[i];
+        metrics->in_strength_dca[d] += g->in_strength[i];
+     }
+  metrics->num_edges = g->num_edges;
+  metrics->num_links = g->link_start[n];
+  metrics->mean_degree = (metrics->active_farms > 0) ? (double)metrics->num_links / metrics->active_farms : 0;
+  metrics->out_degree_dis = g->out_degree_dis;
+  metrics->in_degree_dis = g->in_degree_dis;
+
+  metrics->largest_wcc = largest_wcc(g);
+  metrics->largest_scc = largest_scc(g);
+  count_reach(g, reach_steps, &metrics->mean_reach, &metrics->max_reach);
+  if (metrics->active_farms > 0)
+     {
+        metrics->mean_reach = metrics->mean_reach / metrics->active_farms;
+     }
+}
+
+void network_destroy(struct network_graph *g)
+{
+  free(g->edge_src); free(g->edge_des); free(g->out_start); free(g->out_adj); free(g->row_count);
+  free(g->link_start); free(g->link_adj); free(g->in_start); free(g->in_adj);
+  free(g->out_strength); free(g->in_strength); free(g->out_degree_dis); free(g->in_degree_dis);
+  free(g->parent); free(g->comp_size);
+  free(g->scc_index); free(g->scc_low); free(g->scc_stack); free(g->call_node); free(g->call_pos); free(g->on_stack);
+  free(g);
+}
+
+/* -------------------------------------------------------------------------- */
+/* CSR OF ALL BATCHES, THEN OF THE DISTINCT LINKS BY SOURCE AND BY DESTINATION */
+/* -------------------------------------------------------------------------- */
+static void build_csr(struct network_graph *g)
+{
+  long int n = g->num_farms;
+  long int i, e, k, num_unique;
+
+  /* COUNTING SORT OF THE BATCHES BY SOURCE*/
+  memset(g->row_count, 0, sizeof(long int) * (n + 1));
+  for (e = 0; e < g->num_edges; e++)
+     {
+        g->row_count[g->edge_src[e]]++;
+     }
+  g->out_start[0] = 0;
+  for (i = 0; i < n; i++)
+     {
+        g->out_start[i+1] = g->out_start[i] + g->row_count[i];
+        g->row_count[i] = g->out_start[i]; // now the fill position of row i
+     }
+  for (e = 0; e < g->num_edges; e++)
+     {
+        g->out_adj[g->row_count[g->edge_src[e]]++] = g->edge_des[e];
+     }
+
+  /* SORT EACH ROW AND KEEP ONE ENTRY PER DESTINATION; row_count becomes the number of distinct links*/
+#pragma omp parallel for schedule(dynamic, 256) private(k, num_unique)
+  for (i = 0; i < n; i++)
+     {
+        int32_t *row = g->out_adj + g->out_start[i];
+        long int len = g->out_start[i+1] - g->out_start[i];
+        if (len > 1)
+           {
+              qsort(row, len, sizeof(int32_t), comp_int32);
+           }
+        num_unique = 0;
+        for (k = 0; k < len; k++)
+           {
+              if (k == 0 || row[k] != row[k-1])
+                 {
+                    row[num_unique] = row[k];
+                    num_unique++;
+                 }
+           }
+        g->row_count[i] = num_unique;
+     }
+  g->link_start[0] = 0;
+  for (i = 0; i < n; i++)
+     {
+        g->link_start[i+1] = g->link_start[i] + g->row_count[i];
+     }
+#pragma omp parallel for schedule(dynamic, 256)
+  for (i = 0; i < n; i++)
+     {
+        memcpy(g->link_adj + g->link_start[i], g->out_adj + g->out_start[i], sizeof(int32_t) * g->row_count[i]);
+     }
+
+  /* TRANSPOSE THE LINKS: ROWS OF SOURCES PER DESTINATION*/
+  memset(g->row_count, 0, sizeof(long int) * (n + 1));
+  for (e = 0; e < g->link_start[n]; e++)
+     {
+        g->row_count[g->link_adj[e]]++;
+     }
+  g->in_start[0] = 0;
+  for (i = 0; i < n; i++)
+     {
+        g->in_start[i+1] = g->in_start[i] + g->row_count[i];
+        g->row_count[i] = g->in_start[i];
+     }
+  for (i = 0; i < n; i++)
+     {
+        for (e = g->link_start[i]; e < g->link_start[i+1]; e++)
+           {
+              g->in_adj[g->row_count[g->link_adj[e]]++] = (int32_t)i;
+           }
+     }
+}
+
+/* -------------------------------------------------------------------------- */
+/* LARGEST WEAKLY CONNECTED COMPONENT (union-find with path halving) */
+/* -------------------------------------------------------------------------- */
+static int32_t find_root(int32_t *parent, int32_t v)
+{
+  while (parent[v] != v)
+     {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+     }
+  return (v);
+}
+
+static long int largest_wcc(struct network_graph *g)
+{
+  long int n = g->num_farms;
+  long int i, e, largest = 0;
+  int32_t a, b;
+
+  for (i = 0; i < n; i++)
+     {
+        g->parent[i] = (int32_t)i;
+        g->comp_size[i] = 0;
+     }
+  for (i = 0; i < n; i++)
+     {
+        for (e = g->link_start[i]; e < g->link_start[i+1]; e++)
+           {
+              a = find_root(g->parent, (int32_t)i);
+              b = find_root(g->parent, g->link_adj[e]);
+              if (a != b)
+                 {
+                    g->parent[a] = b;
+                 }
+           }
+     }
+  for (i = 0; i < n; i++)
+     {
+        a = find_root(g->parent, (int32_t)i);
+        g->comp_size[a]++;
+        if (g->comp_size[a] > largest)
+           {
+              largest = g->comp_size[a];
+           }
+     }
+  return (largest);
+}
+
+/* -------------------------------------------------------------------------- */
+/* LARGEST STRONGLY CONNECTED COMPONENT (Tarjan's algorithm with an explicit call stack) */
+/* -------------------------------------------------------------------------- */
+static long int largest_scc(struct network_graph *g)
+{
+  long int n = g->num_farms;
+  long int v, size, largest = 0;
+  int32_t u, w, parent_node, next_index = 0;
+  int top, num_stack = 0;
+
+  for (v = 0; v < n; v++)
+     {
+        g->scc_index[v] = -1;
+        g->on_stack[v] = 0;
+     }
+  for (v = 0; v < n; v++)
+     {
+        if (g->scc_index[v] != -1)
+           {
+              continue;
+           }
+        top = 0;
+        g->call_node[top] = (int32_t)v;
+        g->call_pos[top] = g->link_start[v];
+        top++;
+        g->scc_index[v] = g->scc_low[v] = next_index++;
+        g->scc_stack[num_stack++] = (int32_t)v;
+        g->on_stack[v] = 1;
+        while (top > 0)
+           {
+              u = g->call_node[top-1];
+              if (g->call_pos[top-1] < g->link_start[u+1])
+                 {
+                    w = g->link_adj[g->call_pos[top-1]];
+                    g->call_pos[top-1]++;
+                    if (g->scc_index[w] == -1)
+                       {
+                          g->scc_index[w] = g->scc_low[w] = next_index++;
+                          g->scc_stack[num_stack++] = w;
+                          g->on_stack[w] = 1;
+                          g->call_node[top] = w;
+                          g->call_pos[top] = g->link_start[w];
+                          top++;
+                       }
+                    else if (g->on_stack[w] == 1 && g->scc_index[w] < g->scc_low[u])
+                       {
+                          g->scc_low[u] = g->scc_index[w];
+                       }
+                 }
+              else
+                 {
+                    /* u IS THE ROOT OF A COMPONENT: POP IT*/
+                    if (g->scc_low[u] == g->scc_index[u])
+                       {
+                          size = 0;
+                          do
+                             {
+                                w = g->scc_stack[--num_stack];
+                                g->on_stack[w] = 0;
+                                size++;
+                             }
+                          while (w != u);
+                          if (size > largest)
+                             {
+                                largest = size;
+                             }
+                       }
+                    top--;
+                    if (top > 0)
+                       {
+                          parent_node = g->call_node[top-1];
+                          if (g->scc_low[u] < g->scc_low[parent_node])
+                             {
+                                g->scc_low[parent_node] = g->scc_low[u];
+                             }
+                       }
+                 }
+           }
+     }
+  return (largest);
+}
+
+/* -------------------------------------------------------------------------- */
+/* FARMS REACHABLE WITHIN reach_steps LINKS: breadth-first search from every
+active farm, sources shared out between threads. mean_reach returns the sum. */
+/* -------------------------------------------------------------------------- */
+static void count_reach(struct network_graph *g, int reach_steps, double *mean_reach, long int *max_reach)
+{
+  long int n = g->num_farms;
+  double total_reach = 0;
+  long int most_reach = 0;
+
+  *mean_reach = 0;
+  *max_reach = 0;
+  if (n <= 0 || g->num_edges == 0)
+     {
+        return;
+     }
+#pragma omp parallel reduction(+:total_reach) reduction(max:most_reach)
+  {
+     int32_t *mark = (int32_t*)calloc(n, sizeof(int32_t)); // source + 1 when visited from source, so it is never cleared
+     int32_t *queue = (int32_t*)malloc(sizeof(int32_t) * n);
+     long int s, head, tail, level_end, e, reach;
+     int32_t u, w;
+     int step;
+
+#pragma omp for schedule(dynamic, 64)
+     for (s = 0; s < n; s++)
+        {
+           if (g->out_strength[s] == 0 && g->in_strength[s] == 0)
+              {
+                 continue;
+              }
+           head = 0;
+           tail = 0;
+           queue[tail++] = (int32_t)s;
+           mark[s] = (int32_t)(s + 1);
+           for (step = 0; step < reach_steps && head < tail; step++)
+              {
+                 level_end = tail;
+                 while (head < level_end)
+                    {
+                       u = queue[head++];
+                       for (e = g->link_start[u]; e < g->link_start[u+1]; e++)
+                          {
+                             w = g->link_adj[e];
+                             if (mark[w] != s + 1)
+                                {
+                                   mark[w] = (int32_t)(s + 1);
+                                   queue[tail++] = w;
+                                }
+                          }
+                    }
+              }
+           reach = tail - 1; // not counting the source itself
+           total_reach += reach;
+           if (reach > most_reach)
+              {
+                 most_reach = reach;
+              }
+        }
+     free(mark);
+     free(queue);
+  }
+  *mean_reach = total_reach;
+  *max_reach = most_reach;
+}
+
+/* -------------------------------------------------------------------------- */
+/* TEMPORAL REACHABILITY
+words[v] holds the bitset of the sources of the block that have reached farm v
+so far. Movements are visited in day order; a movement src -> des on day t
+adds words[src] as it was before day t to words[des], so a path can not use
+two movements of the same day. Once all days are done, source s reaches every
+farm v other than itself whose words[v] has the bit of s. */
+/* -------------------------------------------------------------------------- */
+struct temporal_reach *temporal_reach_create(long int num_farms, int num_slots)
+{
+  struct temporal_reach *tr = (struct temporal_reach*)calloc(1, sizeof(struct temporal_reach));
+
+  tr->num_farms = num_farms;
+  tr->num_slots = num_slots;
+  tr->slots = (struct reach_slot*)calloc(num_slots, sizeof(struct reach_slot));
+  return (tr);
+}
+
+void temporal_reach_clear(struct temporal_reach *tr)
+{
+  int s;
+
+  for (s = 0; s < tr->num_slots; s++)
+     {
+        tr->slots[s].num_edges = 0;
+     }
+}
+
+void temporal_reach_add_edge(struct temporal_reach *tr, int slot_id, int src_farm, int des_farm, int day)
+{
+  struct reach_slot *slot = &tr->slots[slot_id];
+
+  if (slot->num_edges == slot->cap_edges)
+     {
+        slot->cap_edges = (slot->cap_edges == 0) ? 1024 : slot->cap_edges * 2;
+        slot->src = (int32_t*)realloc(slot->src, sizeof(int32_t) * slot->cap_edges);
+        slot->des = (int32_t*)realloc(slot->des, sizeof(int32_t) * slot->cap_edges);
+        slot->day = (int32_t*)realloc(slot->day, sizeof(int32_t) * slot->cap_edges);
+        slot->sorted_src = (int32_t*)realloc(slot->sorted_src, sizeof(int32_t) * slot->cap_edges);
+        slot->sorted_des = (int32_t*)realloc(slot->sorted_des, sizeof(int32_t) * slot->cap_edges);
+     }
+  slot->src[slot->num_edges] = (int32_t)src_farm;
+  slot->des[slot->num_edges] = (int32_t)des_farm;
+  slot->day[slot->num_edges] = (int32_t)day;
+  slot->num_edges++;
+}
+
+/* COUNTING SORT OF THE MOVEMENTS OF A SLOT BY DAY; day[] is rewritten in the sorted order*/
+static void sort_reach_slot(struct temporal_reach *tr, struct reach_slot *slot)
+{
+  long int e, d, num_days = 0, pos;
+
+  for (e = 0; e < slot->num_edges; e++)
+     {
+        if (slot->day[e] + 1 > num_days)
+           {
+              num_days = slot->day[e] + 1;
+           }
+     }
+  if (num_days > tr->cap_days)
+     {
+        tr->cap_days = num_days;
+        tr->day_count = (long int*)realloc(tr->day_count, sizeof(long int) * (tr->cap_days + 1));
+     }
+  memset(tr->day_count, 0, sizeof(long int) * (num_days + 1));
+  for (e = 0; e < slot->num_edges; e++)
+     {
+        tr->day_count[slot->day[e]]++;
+     }
+  slot->max_day_edges = 0;
+  pos = 0;
+  for (d = 0; d < num_days; d++)
+     {
+        if (tr->day_count[d] > slot->max_day_edges)
+           {
+              slot->max_day_edges = tr->day_count[d];
+           }
+        e = tr->day_count[d];
+        tr->day_count[d] = pos; // now the fill position of day d
+        pos = pos + e;
+     }
+  for (e = 0; e < slot->num_edges; e++)
+     {
+        pos = tr->day_count[slot->day[e]]++;
+        slot->sorted_src[pos] = slot->src[e];
+        slot->sorted_des[pos] = slot->des[e];
+     }
+  pos = 0;
+  for (d = 0; d < num_days; d++)
+     {
+        while (pos < tr->day_count[d])
+           {
+              slot->day[pos] = (int32_t)d;
+              pos++;
+           }
+     }
+}
+
+/* -------------------------------------------------------------------------- */
+/* temporal_reach_compute: REACHABILITY SIZES OF ALL FARMS FOR SLOTS 0 .. num_slots-1.
+Every (slot, source block) pair is an independent task. */
+/* -------------------------------------------------------------------------- */
+void temporal_reach_compute(struct temporal_reach *tr, int num_slots, int32_t *reach_size)
+{
+  long int n = tr->num_farms;
+  long int num_blocks = (n + REACH_BLOCK - 1) / REACH_BLOCK;
+  long int num_tasks = num_blocks * num_slots;
+  long int max_day_edges = 1;
+  int s;
+
+  if (n <= 0)
+     {
+        return;
+     }
+  for (s = 0; s < num_slots; s++)
+     {
+        sort_reach_slot(tr, &tr->slots[s]);
+        if (tr->slots[s].max_day_edges > max_day_edges)
+           {
+              max_day_edges = tr->slots[s].max_day_edges;
+           }
+     }
+  memset(reach_size, 0, sizeof(int32_t) * n * num_slots);
+
+#pragma omp parallel
+  {
+     uint64_t *words = (uint64_t*)malloc(sizeof(uint64_t) * REACH_WORDS * n);
+     uint64_t *day_buf = (uint64_t*)malloc(sizeof(uint64_t) * REACH_WORDS * max_day_edges);
+     long int task;
+
+#pragma omp for schedule(dynamic)
+     for (task = 0; task < num_tasks; task++)
+        {
+           long int slot_id = task / num_blocks;
+           reach_block(&tr->slots[slot_id], n, (task % num_blocks) * REACH_BLOCK, words, day_buf, reach_size + slot_id * n);
+        }
+     free(words);
+     free(day_buf);
+  }
+}
+
+/* One source block of one slot. Only reach_size[first_source .. first_source+REACH_BLOCK-1] is written*/
+static void reach_block(const struct reach_slot *slot, long int num_farms, long int first_source, uint64_t *words, uint64_t *day_buf, int32_t *reach_size)
+{
+  long int v, e, first, last, s;
+  int k;
+  uint64_t w;
+  uint64_t *from, *to, *buf;
+
+  memset(words, 0, sizeof(uint64_t) * REACH_WORDS * num_farms);
+  for (s = first_source; s < first_source + REACH_BLOCK && s < num_farms; s++)
+     {
+        words[s * REACH_WORDS + (s - first_source) / 64] |= (uint64_t)1 << ((s - first_source) % 64);
+     }
+
+  /* ONE DAY AT A TIME: READ ALL SOURCES FIRST, THEN WRITE ALL DESTINATIONS*/
+  for (first = 0; first < slot->num_edges; first = last)
+     {
+        last = first;
+        while (last < slot->num_edges && slot->day[last] == slot->day[first])
+           {
+              from = words + (long int)slot->sorted_src[last] * REACH_WORDS;
+              buf = day_buf + (last - first) * REACH_WORDS;
+              for (k = 0; k < REACH_WORDS; k++)
+                 {
+                    buf[k] = from[k];
+                 }
+              last++;
+           }
+        for (e = first; e < last; e++)
+           {
+              to = words + (long int)slot->sorted_des[e] * REACH_WORDS;
+              buf = day_buf + (e - first) * REACH_WORDS;
+              for (k = 0; k < REACH_WORDS; k++)
+                 {
+                    to[k] |= buf[k];
+                 }
+           }
+     }
+
+  /* COUNT THE FARMS REACHED BY EACH SOURCE*/
+  for (v = 0; v < num_farms; v++)
+     {
+        for (k = 0; k < REACH_WORDS; k++)
+           {
+              w = words[v * REACH_WORDS + k];
+              while (w != 0)
+                 {
+                    s = first_source + k * 64 + lowest_bit(w);
+                    if (s != v)
+                       {
+                          reach_size[s]++;
+                       }
+                    w = w & (w - 1);
+                 }
+           }
+     }
+}
+
+/* Index of the lowest set bit of a non-zero word*/
+static int lowest_bit(uint64_t w)
+{
+#if defined(__GNUC__)
+  return (__builtin_ctzll(w));
+#else
+  int b = 0;
+  while ((w & 1) == 0)
+     {
+        w = w >> 1;
+        b++;
+     }
+  return (b);
+#endif
+}
+
+void temporal_reach_destroy(struct temporal_reach *tr)
+{
+  int s;
+
+  for (s = 0; s < tr->num_slots; s++)
+     {
+        free(tr->slots[s].src); free(tr->slots[s].des); free(tr->slots[s].day);
+        free(tr->slots[s].sorted_src); free(tr->slots[s].sorted_des);
+     }
+  free(tr->slots);
+  free(tr->day_count);
+  free(tr);
+}
+
+/* Sorting function for the rows*/
+static int comp_int32(const void *a, const void *b)
+{
+  int32_t x = *(const int32_t*)a;
+  int32_t y = *(const int32_t*)b;
+  return ((x > y) - (x < y));
+}
+/* -------------------------------------------------------------------------- */
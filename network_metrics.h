@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------*/
+/* Network metrics of a rewired network.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+The matched movements of one iteration are added as edges (source farm ->
+destination farm, one per batch), then network_compute builds a CSR graph in
+buffers that are kept and reused for the next iteration, and fills in the
+metrics compared between rewired networks:
+  - in/out degree (distinct partner farms) and their distributions,
+  - in/out strength (batches) summed by DCA of the farm,
+  - sizes of the largest strongly and weakly connected components,
+  - number of farms reachable within reach_steps movements.
+The temporal reachability counts, for every farm, the farms reached by
+time-respecting paths: chains of movements on strictly increasing days. The
+movements of several iterations are kept in slots and solved together, with
+the source farms handled 256 at a time as bitsets.
+Build with -fopenmp to compute the row sorting and the reachability in parallel
+(over source blocks and iterations). */
+/*------------------------------------------------------------------------------*/
+#ifndef NETWORK_METRICS_H
+#define NETWORK_METRICS_H
+
+#include <stdint.h>
+
+#include "rewire_engine.h" // NUM_DCA_CODES
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */
+
+  struct network_metrics {
+      long int num_edges;      // batches
+      long int num_links;      // distinct source -> destination pairs
+      long int active_farms;   // farms with at least one batch in or out
+      int max_out_degree;
+      int max_in_degree;
+      double mean_degree;      // num_links per active farm
+      long int out_strength_dca[NUM_DCA_CODES]; // batches leaving farms of DCA 0-4 and unknown
+      long int in_strength_dca[NUM_DCA_CODES];  // batches arriving at farms of DCA 0-4 and unknown
+      long int largest_scc;
+      long int largest_wcc;
+      double mean_reach;       // farms reachable within reach_steps, averaged over active farms
+      long int max_reach;
+      /* Degree distributions: number of farms with degree d at [d], d = 0 .. max_*_degree. Owned by the graph*/
+      const int32_t *out_degree_dis;
+      const int32_t *in_degree_dis;
+   };
+
+  struct network_graph; // opaque
+  struct temporal_reach; // opaque
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+struct network_graph *network_create(long int num_farms);
+void network_clear(struct network_graph *graph); // drop the edges, keep the buffers
+void network_add_edge(struct network_graph *graph, int src_farm, int des_farm);
+void network_compute(struct network_graph *graph, const uint8_t *testarea, int reach_steps, struct network_metrics *metrics);
+void network_destroy(struct network_graph *graph);
+
+struct temporal_reach *temporal_reach_create(long int num_farms, int num_slots);
+void temporal_reach_clear(struct temporal_reach *reach); // drop the movements of all slots, keep the buffers
+void temporal_reach_add_edge(struct temporal_reach *reach, int slot, int src_farm, int des_farm, int day);
+void temporal_reach_compute(struct temporal_reach *reach, int num_slots, int32_t *reach_size); // reach_size[slot * num_farms + farm]: farms reachable from farm
+void temporal_reach_destroy(struct temporal_reach *reach);
+
+#endif
@@ -0,0 +1,2294 @@
+/*------------------------------------------------------------------------------*/
+/* Rewiring engine used to re-wire New Zealand dairy cattle movement.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Load, distance table, matching and histogram stages of the rewiring. The API is
+declared and documented in rewire_engine.h.
+
+Rewire steps.
+/* 1 Get the outward stubs orderd by date
+/* 2 Pick up a single distance for this outward stub. This distance is already estimated based on hurdle regression models.
+/* 3 Pick up inward stubs that best match to the outward stubs, by distance and by date. First criteria is distance.
+/* 4 Go through all eligible inward stubs and overwrite if better one appears.
+/* 5 Get the best inward stubs and connect them.
+/* 6 Delete this inward from the list.
+/* 7 Store the created new movements.
+/* 8 Go through all outward stubs until all find their matches. */
+
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "rewire_engine.h"
+
+#define STUB_KEY_ANY 0xFF // stratum value used when a key is not stratified
+#define STUB_KEY_EMPTY 0xFFFFFFFFu // marks a free entry in a bucket table
+#define ASSIGN_FORBIDDEN 100000000 // cost of a pair the assignment engine may not use
+#define ROAD_DISTANCE_MAGIC "RWDIST1" // first 8 bytes of a road distance file (with the terminating 0)
+#define PREDICTION_MAGIC "RWPRED1" // first 8 bytes of a streamed prediction file
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */  
+  struct stub_node {
+      int32_t farm_id;   
+      uint8_t batch_type;
+      uint8_t taken; // already given to a destination by the assignment engine, deleted in step 3.5
+      struct stub_node *next_node;
+   };   
+
+  /* Stubs of one day are split into buckets by a composite key of batch type,
+     island and source DCA, held in a small open-addressing hash table. A
+     destination only visits the buckets its stratification allows. */
+  struct stub_bucket {
+      uint32_t key;
+      int count;
+      struct stub_node *head;
+      double min_x, max_x, min_y, max_y; // bounding box of the source farms ever added, for the lower bound
+   };
+
+  /* Settings of the matching that are passed on to the search functions*/
+  struct match_options {
+      int error_range_day_movement;
+      int days_after; // days after the movement day an inward stub may come from (symmetric window)
+      int day_window;
+      int strat_island;
+      int strat_dca;
+      int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES];
+      int assign_candidates; // assignment engine keeps this many cheapest stubs per destination (0 keeps all)
+      int assign_unmatched_cost; // cost of the "unmatched" column of a destination, ASSIGN_FORBIDDEN to match as many as possible
+      int num_day_offsets;
+      int *day_offsets; // days searched relative to the movement day, in order
+      int road_distances; // 1: some distances come from the road distance file, only the near side of a bucket box bounds them
+      int road_slack; // km a road distance may fall short of the straight line distance
+   };
+
+  /* Road distances of selected farm pairs, CSR by source farm, as laid out in the
+     file (little-endian, see tools/make_road_distances.c):
+       char magic[8]; int64_t num_farms; int64_t num_entries;
+       uint64_t row_start[num_farms + 1];
+       int32_t des_farm[num_entries]; // ascending within each row
+       uint16_t km[num_entries];
+     The file is memory-mapped and the arrays point into it. */
+  struct road_distances {
+      void *map;
+      size_t map_size;
+      int64_t num_farms, num_entries;
+      const uint64_t *row_start;
+      const int32_t *des_farm;
+      const uint16_t *km;
+   };
+
+  /* Scratch buffers of the assignment engine, grown as needed and reused between blocks*/
+  struct assign_workspace {
+      long int cap_cols, cap_rows, cap_edges, cap_heap;
+      /* Candidate stubs (columns); column m + r is the "unmatched" column of row r*/
+      struct stub_node **col_node;
+      struct stub_bucket **col_bucket;
+      int *col_day;
+      /* Sparse cost graph, CSR by row: the assign_candidates cheapest stubs of each destination*/
+      long int *row_start;
+      long int *row_edges; // pairs kept by each row before the CSR is packed
+      long int *row_valid; // pairs each row could have, more than row_edges when some were cut
+      int32_t unmatched_cost;
+      int *edge_col;
+      int32_t *edge_cost;
+      /* Shortest augmenting path solver*/
+      int64_t *u, *v;     // row and column potentials
+      int64_t *dist;      // distance of a column in the current search, INT64_MAX if not reached
+      int64_t *row_dist;  // distance of a row in the current search
+      int *p;             // row holding a column, -1 if free
+      int *way;           // row a column was reached from
+      int *row_col;       // column held by a row
+      char *done;         // column's distance final in the current search
+      int *touched;       // columns reached in the current search
+      int64_t *heap_dist; // binary heap of (distance, column), stale entries skipped
+      int *heap_col;
+   };
+
+  /* One day of the window: its stub buckets, and its movements while they wait
+     for the days after them to be loaded (symmetric window). */
+  struct day_buckets {
+      int day; // -1 while the slot holds no day
+      int num_used;
+      int capacity; // power of two
+      struct stub_bucket *table;
+      int pending; // 1 until the movements of this day are rewired
+      long int moves_capacity;
+      struct move_table moves;
+   };
+
+  /* Sort key for the random ordering of movements: day and a random number
+     packed into one integer, plus the index of the movement it refers to. */
+  struct move_sort_key {
+      uint64_t key;
+      int32_t move;
+   };
+
+  /* Source of movements for Loop B, handed out one day at a time in day order.
+     Either all movements are in memory (MoveData visited through move_order), or
+     file is a movement file sorted by day that is read as the iteration goes. */
+  struct move_stream {
+      FILE *file;
+      struct move_table *MoveData;
+      struct move_sort_key *move_order;
+      long int cursor;      // next position in move_order
+      long int capacity;    // rows allocated in the day buffer
+      int has_pending;      // a movement of the next day has already been read from file
+      int32_t pending_src, pending_des, pending_move_id;
+      int pending_day, pending_batch;
+      uint16_t pending_pred;
+      int last_day;
+      FILE *pred_file;      // predictions read line by line with the movements, NULL to look them up in CovPredData
+      long int pred_rows;   // predictions of one iteration in pred_file, one per line of the movement file
+      long int pred_read;   // predictions of this iteration read so far
+   };
+
+  /* Everything the engine keeps between calls. Arrays marked caller are only borrowed.*/
+  struct rewire_engine {
+      struct rewire_config config;
+      struct match_options opts;
+      int days_ahead;   // days loaded ahead of the day being rewired (symmetric window)
+      int assign_ahead; // engine 1: also the outward stubs of the next error_range_day_movement days join the blocks of a day
+      struct farm_table FarmData;       // caller columns
+      struct move_table MoveData;       // caller columns (in-memory movements)
+      struct move_sort_key *move_order; // Order in which Loop B visits the movements; re-sorted every iteration
+      struct move_stream Moves;
+      struct move_table DayMoves;       // movements of the day just read
+      uint16_t **dis_matrix;
+      int max_dis;
+      struct road_distances road;       // num_entries 0 unless rewire_load_road_distances succeeded
+      const uint16_t *CovPredData;      // caller: predicted distance of move_id in iteration count_iter at [move_id * pred_stride + count_iter], unused when Moves.pred_file is set
+      long int num_covs, pred_stride;
+      struct rewire_histograms hist;    // caller buffers
+      rewire_match_fn on_match;
+      rewire_unmatched_fn on_unmatched;
+      void *user;
+      struct day_buckets *outstubs_day; // Day window: only stubs of the last day_window days are kept, whatever the length of the horizon
+      int *array_ordered_day;
+      /* Movements of the day being rewired followed by those of the days after it in its
+         blocks, and the results of the assignment engine, indexed like these movements*/
+      struct move_table WinMoves;
+      long int win_capacity;
+      long int day_capacity;
+      int *day_selected_dis;
+      struct stub_node **day_best_node;
+      struct stub_bucket **day_best_bucket;
+      int *day_best_day;
+   };
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+static void add_node_to_day(struct stub_node *day_list[], int day, struct stub_node *node_to_add);
+static int remove_node_from_day(struct stub_node *day_list[], int day, struct stub_node *node_to_remove);
+static int comp_random(const void* a, const void* b);
+static unsigned int rand_interval(unsigned int min, unsigned int max);
+
+static void order_moves_by_day(struct move_table *MoveData, struct move_sort_key *move_order, long int num_moves);
+static void rewind_move_stream(struct move_stream *stream, long int count_iter);
+static long int next_day_moves(struct move_stream *stream, struct move_table *DayMoves);
+static int retire_day(struct rewire_engine *e, struct day_buckets *day_slot, long int count_iter);
+static uint32_t stub_key(int batch_type, int island, int dca);
+static int dca_code(int testarea);
+static struct stub_bucket *find_stub_bucket(struct day_buckets *day_slot, uint32_t key, int create);
+static int destination_stub_keys(int batch_type, int des_island, int des_testarea, int strat_island, int strat_dca, int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES], uint32_t keys[]);
+static int scan_stub_bucket(struct stub_bucket *bucket, int des_farm_id, int selected_dis, uint16_t **dis_matrix, int *min_diff, struct stub_node **best_node);
+static void extend_bucket_box(struct stub_bucket *bucket, double x, double y);
+static int bucket_lower_bound(struct stub_bucket *bucket, double des_x, double des_y, int selected_dis, const struct match_options *opts);
+static int first_pending_day(struct day_buckets *outstubs_day, int day_window);
+static void copy_moves(struct move_table *To, long int *capacity, long int first, const struct move_table *From);
+static void keep_day_moves(struct day_buckets *day_slot, struct move_table *DayMoves);
+static void assign_day(struct move_table *DayMoves, long int num_rows, long int num_day_moves, int *day_selected_dis, struct day_buckets *outstubs_day,
+                    struct farm_table *FarmData, uint16_t **dis_matrix, const struct match_options *opts,
+                    struct stub_node **day_best_node, struct stub_bucket **day_best_bucket, int *day_best_day);
+static void count_move(struct rewire_engine *e, long int column, int src_farm_id, int des_farm_id, int batch_type, int by_batch);
+
+
+/* ########################################################################## */
+/* ENGINE API */
+
+/* -------------------------------------------------------------------------- */
+/* DEFAULT SETTINGS: greedy matching within 7 days before the movement, no stratification */
+/* -------------------------------------------------------------------------- */
+void rewire_default_config(struct rewire_config *config)
+{
+  int i, j;
+
+  config->num_simu = 1000;
+  config->error_range_day_movement = 7;
+  config->symmetric_window = 0;
+  config->prune_buckets = 1;
+  config->strat_island = 0;
+  config->strat_dca = 0;
+  for (i = 0; i < NUM_DCA_CODES; i++)
+     {
+        for (j = 0; j < NUM_DCA_CODES; j++)
+           {
+              config->allowed_dca[i][j] = 1;
+           }
+     }
+  config->match_engine = 0;
+  config->assign_candidates = 128;
+  config->assign_unmatched_cost = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* rewire_create: SET UP THE DAY WINDOW FOR THE GIVEN SETTINGS AND FARMS.
+The farm columns stay owned by the caller and must outlive the engine. */
+/* -------------------------------------------------------------------------- */
+struct rewire_engine *rewire_create(const struct rewire_config *config, const struct farm_table *FarmData)
+{
+  struct rewire_engine *e = (struct rewire_engine*)calloc(1, sizeof(struct rewire_engine));
+  int i, day_window, num_day_offsets;
+
+  e->config = *config;
+  e->FarmData = *FarmData;
+  e->days_ahead = (config->symmetric_window == 1) ? config->error_range_day_movement : 0;
+  e->assign_ahead = config->error_range_day_movement + e->days_ahead;
+  day_window = config->error_range_day_movement + e->assign_ahead + 1; // number of days whose stubs are kept in memory at once, enough for either engine
+
+  /* in order for loop to be used for searching best farm +/- range days, make array of day offsets that tells the order of searching: 0, -1, (+1), -2, (+2), ...*/
+  e->array_ordered_day = (int*)malloc(sizeof(int) * day_window);
+  num_day_offsets = 1;
+  e->array_ordered_day[0] = 0;
+  for (i = 1; i <= config->error_range_day_movement; i++)
+     {
+        e->array_ordered_day[num_day_offsets] = -i;
+        num_day_offsets++;
+        if (i <= e->days_ahead)
+           {
+              e->array_ordered_day[num_day_offsets] = i;
+              num_day_offsets++;
+           }
+     }
+  e->outstubs_day = (struct day_buckets*)calloc(day_window, sizeof(struct day_buckets));
+
+  e->opts.error_range_day_movement = config->error_range_day_movement;
+  e->opts.days_after = e->days_ahead;
+  e->opts.day_window = day_window;
+  e->opts.strat_island = config->strat_island;
+  e->opts.strat_dca = config->strat_dca;
+  memcpy(e->opts.allowed_dca, config->allowed_dca, sizeof(e->opts.allowed_dca));
+  e->opts.assign_candidates = config->assign_candidates;
+  e->opts.assign_unmatched_cost = (config->assign_unmatched_cost > 0 && config->assign_unmatched_cost < ASSIGN_FORBIDDEN) ? config->assign_unmatched_cost : ASSIGN_FORBIDDEN;
+  e->opts.num_day_offsets = num_day_offsets;
+  e->opts.day_offsets = e->array_ordered_day;
+  return (e);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Release the mapping (or the copy) of the road distance file and forget it*/
+/* -------------------------------------------------------------------------- */
+static void unmap_road_distances(struct road_distances *road)
+{
+  if (road->map != NULL)
+     {
+#ifndef _WIN32
+        munmap(road->map, road->map_size);
+#else
+        free(road->map);
+#endif
+     }
+  memset(road, 0, sizeof(*road));
+}
+
+/* Check the CSR before any of it is used as an index: rows start at 0, never go
+back and end at num_entries, destinations are farms, ascending within a row.
+Returns 0, -1 if the file is inconsistent*/
+static int check_road_distances(const struct road_distances *road)
+{
+  int64_t i;
+  uint64_t k;
+
+  if (road->row_start[0] != 0 || road->row_start[road->num_farms] != (uint64_t)road->num_entries)
+     {
+        return (-1);
+     }
+  for (i = 0; i < road->num_farms; i++)
+     {
+        if (road->row_start[i+1] < road->row_start[i])
+           {
+              return (-1);
+           }
+        for (k = road->row_start[i]; k < road->row_start[i+1]; k++)
+           {
+              if (road->des_farm[k] < 0 || road->des_farm[k] >= road->num_farms || (k > road->row_start[i] && road->des_farm[k] <= road->des_farm[k-1]))
+                 {
+                    return (-1);
+                 }
+           }
+     }
+  return (0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* rewire_load_road_distances: MAP A ROAD DISTANCE FILE (call before rewire_build_distances).
+Returns the number of farm pairs with a road distance, or -1 if the file can not be used. */
+/* -------------------------------------------------------------------------- */
+long int rewire_load_road_distances(struct rewire_engine *e, char RoadDistanceFile[])
+{
+  struct road_distances *road = &e->road;
+  char magic[8];
+  int64_t counts[2];
+  size_t header = sizeof(magic) + sizeof(counts);
+  size_t map_size;
+  long int file_size;
+  const char *base;
+
+  /* READ AND CHECK THE HEADER*/
+  FILE *Road = fopen(RoadDistanceFile, "rb");
+  if (Road == NULL)
+     {
+        return (-1);
+     }
+  if (fread(magic, 1, sizeof(magic), Road) != sizeof(magic) || fread(counts, sizeof(int64_t), 2, Road) != 2
+      || memcmp(magic, ROAD_DISTANCE_MAGIC, sizeof(magic)) != 0 || counts[0] != e->FarmData.num_farms || counts[1] < 0)
+     {
+        fclose(Road);
+        return (-1);
+     }
+  /* counts are checked against the file size before they size anything*/
+  fseek(Road, 0, SEEK_END);
+  file_size = ftell(Road);
+  if (file_size < (long int)header || counts[0] + 1 > (file_size - (long int)header) / (int64_t)sizeof(uint64_t)
+      || counts[1] > (file_size - (long int)header) / (int64_t)(sizeof(int32_t) + sizeof(uint16_t)))
+     {
+        fclose(Road);
+        return (-1);
+     }
+  map_size = header + sizeof(uint64_t) * (counts[0] + 1) + (sizeof(int32_t) + sizeof(uint16_t)) * counts[1];
+  if (file_size < (long int)map_size)
+     {
+        fclose(Road);
+        return (-1);
+     }
+
+#ifndef _WIN32
+  fclose(Road);
+  int fd = open(RoadDistanceFile, O_RDONLY);
+  if (fd < 0)
+     {
+        return (-1);
+     }
+  road->map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if (road->map == MAP_FAILED)
+     {
+        road->map = NULL;
+        return (-1);
+     }
+#else
+  /* no mmap: read the whole file*/
+  road->map = malloc(map_size);
+  fseek(Road, 0, SEEK_SET);
+  if (fread(road->map, 1, map_size, Road) != map_size)
+     {
+        free(road->map);
+        road->map = NULL;
+        fclose(Road);
+        return (-1);
+     }
+  fclose(Road);
+#endif
+  road->map_size = map_size;
+  road->num_farms = counts[0];
+  road->num_entries = counts[1];
+  base = (const char*)road->map + header;
+  road->row_start = (const uint64_t*)base;
+  base = base + sizeof(uint64_t) * (counts[0] + 1);
+  road->des_farm = (const int32_t*)base;
+  base = base + sizeof(int32_t) * counts[1];
+  road->km = (const uint16_t*)base;
+  if (check_road_distances(road) != 0)
+     {
+        unmap_road_distances(road);
+        return (-1);
+     }
+  return ((long int)road->num_entries);
+}
+
+/* Road distance of one pair by binary search in the row of src_farm; -1 if the file has none*/
+int rewire_road_distance(const struct rewire_engine *e, int src_farm, int des_farm)
+{
+  const struct road_distances *road = &e->road;
+  uint64_t lo, hi, mid;
+
+  if (road->num_entries == 0 || src_farm < 0 || src_farm >= road->num_farms)
+     {
+        return (-1);
+     }
+  lo = road->row_start[src_farm];
+  hi = road->row_start[src_farm + 1];
+  while (lo < hi)
+     {
+        mid = lo + (hi - lo) / 2;
+        if (road->des_farm[mid] < des_farm)
+           {
+              lo = mid + 1;
+           }
+        else
+           {
+              hi = mid;
+           }
+     }
+  if (lo < road->row_start[src_farm + 1] && road->des_farm[lo] == des_farm)
+     {
+        return (road->km[lo]);
+     }
+  return (-1);
+}
+
+/* -------------------------------------------------------------------------- */
+/* FILL OUT THE DISTANCE MATRIX. Returns max_dis, the maximum possible distance between two farms */
+/* Pairs in the road distance file take the road distance, the others the straight line
+distance, so lookups in the match loop stay a plain matrix read.
+Note: The calculating speed can be improved because it's calculating the pair-wise distance twice*/
+/* -------------------------------------------------------------------------- */
+int rewire_build_distances(struct rewire_engine *e)
+{
+  long int num_farms = e->FarmData.num_farms;
+  long int i, j;
+  uint64_t k;
+  double src_x, src_y;
+  int road_slack = 0;
+
+  /* Distances are whole km, so uint16_t is enough. Rows point into one contiguous block*/
+  e->dis_matrix = (uint16_t**)malloc(sizeof(uint16_t*) * num_farms);
+  e->dis_matrix[0] = (uint16_t*)malloc(sizeof(uint16_t) * num_farms * num_farms);
+  for (i = 1; i < num_farms; i++)
+     {
+        e->dis_matrix[i] = e->dis_matrix[0] + i * num_farms;
+     }
+
+  e->max_dis = 0;
+  for (i = 0; i < num_farms; i++)
+     {
+        src_x = e->FarmData.x_coord[i];
+        src_y = e->FarmData.y_coord[i];
+        for (j = 0; j < num_farms; j++)
+           {
+              e->dis_matrix[i][j] = (uint16_t)rewire_calc_dis(src_x, src_y, e->FarmData.x_coord[j], e->FarmData.y_coord[j]);
+              if (e->dis_matrix[i][j] > e->max_dis)
+                 {
+                    e->max_dis = e->dis_matrix[i][j];
+                 }
+           }
+        if (e->road.num_entries == 0)
+           {
+              continue;
+           }
+        /* ROAD DISTANCES OF THIS ROW; note how much shorter than the straight line they get*/
+        for (k = e->road.row_start[i]; k < e->road.row_start[i+1]; k++)
+           {
+              j = e->road.des_farm[k];
+              if (e->dis_matrix[i][j] - e->road.km[k] > road_slack)
+                 {
+                    road_slack = e->dis_matrix[i][j] - e->road.km[k];
+                 }
+              e->dis_matrix[i][j] = e->road.km[k];
+              if (e->dis_matrix[i][j] > e->max_dis)
+                 {
+                    e->max_dis = e->dis_matrix[i][j];
+                 }
+           }
+     }
+  e->opts.road_distances = (e->road.num_entries > 0) ? 1 : 0;
+  e->opts.road_slack = road_slack;
+  return (e->max_dis);
+}
+
+/* km by which road distances undercut their straight line distance at most (0 without road distances)*/
+int rewire_road_slack(const struct rewire_engine *e)
+{
+  return (e->opts.road_slack);
+}
+
+int rewire_max_dis(const struct rewire_engine *e)
+{
+  return (e->max_dis);
+}
+
+long int rewire_hist_rows(const struct rewire_engine *e)
+{
+  return (e->max_dis + 1);
+}
+
+int rewire_distance(const struct rewire_engine *e, int src_farm, int des_farm)
+{
+  return (e->dis_matrix[src_farm][des_farm]);
+}
+
+/* -------------------------------------------------------------------------- */
+/* MOVEMENT SOURCE: CALLER COLUMNS IN MEMORY, OR A FILE SORTED BY DAY READ EVERY ITERATION */
+/* -------------------------------------------------------------------------- */
+void rewire_set_moves(struct rewire_engine *e, const struct move_table *MoveData)
+{
+  e->MoveData = *MoveData;
+  free(e->move_order);
+  e->move_order = (struct move_sort_key*)malloc(sizeof(struct move_sort_key) * MoveData->num_moves);
+  e->Moves.file = NULL;
+  e->Moves.MoveData = &e->MoveData;
+  e->Moves.move_order = e->move_order;
+  order_moves_by_day(&e->MoveData, e->move_order, e->MoveData.num_moves);
+}
+
+void rewire_set_move_file(struct rewire_engine *e, FILE *MoveFile)
+{
+  e->Moves.file = MoveFile;
+}
+
+/* rewire_set_prediction_file: READ THE PREDICTED DISTANCES WITH THE STREAMED MOVEMENTS.
+PredFile holds, for each iteration in turn, one prediction per line of the movement
+file in the same order (tools/make_stream_predictions.c), so only the movements of
+the day window keep theirs in memory. Returns 0, -1 if the file can not be used.*/
+int rewire_set_prediction_file(struct rewire_engine *e, FILE *PredFile)
+{
+  char magic[8];
+  int64_t counts[2];
+  long int file_size;
+
+  if (e->Moves.file == NULL || PredFile == NULL)
+     {
+        return (-1);
+     }
+  if (fread(magic, 1, sizeof(magic), PredFile) != sizeof(magic) || fread(counts, sizeof(int64_t), 2, PredFile) != 2
+      || memcmp(magic, PREDICTION_MAGIC, sizeof(magic)) != 0 || counts[0] <= 0 || counts[1] < e->config.num_simu)
+     {
+        return (-1);
+     }
+  fseek(PredFile, 0, SEEK_END);
+  file_size = ftell(PredFile);
+  if ((file_size - (long int)(sizeof(magic) + sizeof(counts))) / (int64_t)sizeof(uint16_t) / counts[0] < counts[1])
+     {
+        return (-1);
+     }
+  e->Moves.pred_file = PredFile;
+  e->Moves.pred_rows = (long int)counts[0];
+  return (0);
+}
+
+/* CovPredData[move_id * stride + count_iter] is the predicted distance of move_id in iteration count_iter*/
+void rewire_set_predictions(struct rewire_engine *e, const uint16_t *CovPredData, long int num_covs, long int stride)
+{
+  e->CovPredData = CovPredData;
+  e->num_covs = num_covs;
+  e->pred_stride = stride;
+}
+
+void rewire_set_histograms(struct rewire_engine *e, struct rewire_histograms *hist)
+{
+  e->hist = *hist;
+}
+
+/* Switch between the greedy (0) and assignment (1) engine for the next iterations*/
+void rewire_set_match_engine(struct rewire_engine *e, int match_engine)
+{
+  e->config.match_engine = match_engine;
+}
+
+void rewire_set_callbacks(struct rewire_engine *e, rewire_match_fn on_match, rewire_unmatched_fn on_unmatched, void *user)
+{
+  e->on_match = on_match;
+  e->on_unmatched = on_unmatched;
+  e->user = user;
+}
+
+/* -------------------------------------------------------------------------- */
+/* COUNT ONE MOVEMENT IN COLUMN column OF THE DISTANCE HISTOGRAMS AND ROW column OF THE DCA HISTOGRAM.
+The batch type histograms are only counted when by_batch is 1 (rewired movements). */
+/* -------------------------------------------------------------------------- */
+static void count_move(struct rewire_engine *e, long int column, int src_farm_id, int des_farm_id, int batch_type, int by_batch)
+{
+  long int stride = e->config.num_simu + 1;
+  int dis_src_des = e->dis_matrix[src_farm_id][des_farm_id];
+  int src_testarea = e->FarmData.testarea[src_farm_id];
+  int des_testarea = e->FarmData.testarea[des_farm_id];
+  int test_area_comb;
+
+  if (e->hist.dis_all == NULL)
+     {
+        return;
+     }
+  e->hist.dis_all[dis_src_des * stride + column]++; //INCREASE THE DISTANCE COUNTER BY 1
+  /* Age type specific counter for distance*/
+  if (by_batch == 1 && batch_type == 0)
+     {
+        e->hist.dis_calf[dis_src_des * stride + column]++; //calf
+     }
+  else if (by_batch == 1 && batch_type == 1)
+     {
+        e->hist.dis_heifer[dis_src_des * stride + column]++; //heifer
+     }
+  else if (by_batch == 1 && batch_type == 2)
+     {
+        e->hist.dis_adult[dis_src_des * stride + column]++; //adults
+     }
+
+  // src_testarea, des_testarea specify the DCA status for source and destination farm respectively.
+  // 0 is MCA(Area4), 1 is STA(Area3), 2 is STB(Area2), 3 is STD(Area1b), and 4 is STT(Area1a). test_area_comb defines the unique 26 combinations of src and des DCA status
+  if (src_testarea != 99 && des_testarea != 99)
+     {
+        test_area_comb = src_testarea * 5 + des_testarea;
+     }
+  else
+     {
+        test_area_comb = NUM_DCA_COMBINATIONS - 1; //If testarea of either src or des farm is unknown, then store at column 25.
+     }
+  e->hist.dca[column * NUM_DCA_COMBINATIONS + test_area_comb]++;
+}
+
+/* -------------------------------------------------------------------------- */
+/* rewire_observed: GENERATE THE DISTANCE AND DCA FREQUENCY OF THE OBSERVED MOVEMENTS (column / row 0).
+Each observed movement is also passed to on_match with count_iter -1.
+Returns 0, -1 if the movement file is not sorted by day. */
+/* -------------------------------------------------------------------------- */
+int rewire_observed(struct rewire_engine *e)
+{
+  long int i, num_day_moves;
+  struct rewire_match match;
+
+  rewind_move_stream(&e->Moves, 0);
+  while ((num_day_moves = next_day_moves(&e->Moves, &e->DayMoves)) > 0)
+     {
+        for (i = 0; i < num_day_moves; i++)
+           {
+              count_move(e, 0, e->DayMoves.src_farm[i], e->DayMoves.des_farm[i], e->DayMoves.batch_type[i], 0);
+              if (e->on_match != NULL)
+                 {
+                    match.count_iter = -1;
+                    match.src_farm = e->DayMoves.src_farm[i];
+                    match.des_farm = e->DayMoves.des_farm[i];
+                    match.day = e->DayMoves.day[i];
+                    match.src_day = e->DayMoves.day[i];
+                    match.batch_type = e->DayMoves.batch_type[i];
+                    match.distance = e->dis_matrix[match.src_farm][match.des_farm];
+                    e->on_match(&match, e->user);
+                 }
+           }
+     }
+  return ((num_day_moves < 0) ? -1 : 0);
+}
+
+/* ========================================================================== */
+/* rewire_run_iteration: ONE ITERATION OF THE REWIRE ALGORITHM (LOOP A BODY)
+
+REWIRE STEPS.
+3.2. START LOOP B - LOOP FOR EACH STUBS IN A GIVEN ITERATION.
+3.3. IDENTIFY THE BEST INSTUBS FOR EACH OUTWARD STUB. 
+ 3.3.1. ON THE EXACT MOVEMENT DAY OF OUTWARD STUB.
+ 3.3.2. DAYS WITHIN RANGE.
+3.4. STORE THE IDENTIFIED INSTUB INFORMATION.
+3.5. DELETE THE IDENTIFIED INSTUBS FROM THE LINKED ARRAY LIST.
+3.6. CREATE OUTPUT DATA.
+     3.6.1 CALCULATE THE DISTANCE FREQUENCY.
+     3.6.2 CALCULATE THE FREQUENCY OF BATCH BETWEEN EACH DISEASE CONTROL AREA.
+Returns 0, -1 if the movement file is not sorted by day; the iteration is then
+abandoned and the stubs already loaded are retired as unmatched.*/
+/* ========================================================================== */
+int rewire_run_iteration(struct rewire_engine *e, long int count_iter, struct rewire_iteration_stats *stats)
+{
+     /* INITALISATION OF VARIABLES*/
+     struct farm_table *FarmData = &e->FarmData;
+     struct day_buckets *outstubs_day = e->outstubs_day;
+     int day_window = e->opts.day_window;
+     int error_range_day_movement = e->config.error_range_day_movement;
+     int *array_ordered_day = e->array_ordered_day;
+     struct stub_node *best_node;
+     struct stub_bucket *find_bucket; // bucket currently searched
+     struct stub_bucket *best_bucket; // bucket that holds best_node
+     uint32_t search_keys[NUM_DCA_CODES]; // bucket keys a destination may take stubs from
+     int num_keys;
+     int selected_dis, batch_this_move, day_this_move, move_id_this_move, des_testarea;
+     int src_farm_id, des_farm_id, dis_src_des;
+     int min_diff, search_day, current_day = 0;
+     int day_to_delete = 0;
+     int stream_done, phase, match_day, days_ahead, d;
+     long int i, h, batch, num_day_moves, num_rows;
+     struct day_buckets *day_slot;
+     struct move_table *PendMoves; // movements of the day being rewired
+     struct stub_node *new_node; // each farm struct is also a pointer to a struct   
+     struct rewire_match match;
+
+     memset(stats, 0, sizeof(*stats));
+     stats->count_iter = count_iter;
+     days_ahead = (e->config.match_engine == 1) ? e->assign_ahead : e->days_ahead;
+
+  	/* Reorder the movement data: by day, random within a day*/
+  	if (e->Moves.file == NULL)
+  	{
+  	order_moves_by_day(&e->MoveData, e->move_order, e->MoveData.num_moves);
+  	}
+  	rewind_move_stream(&e->Moves, count_iter);
+  	
+ /* EMPTY THE DAY WINDOW. outstubs_day[day % day_window] holds the stubs of day while its .day == day*/
+          for(i = 0; i < day_window; i++)
+                {
+                outstubs_day[i].day = -1;
+                outstubs_day[i].pending = 0;
+                }
+
+/* 3.2 START OF LOOP B - read one day of movements, then rewire every day whose +/- window is complete*/
+    stream_done = 0;
+    while (stream_done == 0)
+    {
+          num_day_moves = next_day_moves(&e->Moves, &e->DayMoves);
+          if (num_day_moves < 0)
+          {
+              for (i = 0; i < day_window; i++)
+              {
+                  if (outstubs_day[i].day != -1)
+                  {
+                  stats->unmatched = stats->unmatched + retire_day(e, &outstubs_day[i], count_iter);
+                  }
+              }
+              return (-1);
+          }
+          if (num_day_moves == 0)
+          {
+          stream_done = 1;
+          }
+          else
+          {
+          current_day = e->DayMoves.day[0] ;
+          }
+
+     /* Phase 0 rewires the pending days that need nothing from current_day. Phase 1 loads current_day,
+        then rewires the pending days whose window ends at current_day. At the end of the stream all pending days are rewired.*/
+     for (phase = 0; phase < 2; phase++)
+     {
+          if (phase == 1)
+          {
+              if (stream_done == 1)
+              {
+              break;
+              }
+
+          /* RETIRE DAYS THAT NO PENDING OR LATER MOVEMENT CAN REACH; THEIR REMAINING STUBS STAY UNMATCHED*/
+          match_day = first_pending_day(outstubs_day, day_window);
+          if (match_day == -1 || match_day > current_day)
+          {
+          match_day = current_day;
+          }
+          for (i = 0; i < day_window; i++)
+          {
+              if (outstubs_day[i].day != -1 && outstubs_day[i].day < match_day - error_range_day_movement)
+              {
+              stats->unmatched = stats->unmatched + retire_day(e, &outstubs_day[i], count_iter);
+              }
+          }
+
+          /* POPULATE THE SLOT OF THIS DAY THAT WILL BE lINKED BY POINTERS*/ 
+          day_slot = &outstubs_day[current_day % day_window];
+          day_slot->day = current_day;
+          keep_day_moves(day_slot, &e->DayMoves);
+          for (i=0; i < e->DayMoves.num_moves; i++)
+          { 
+                /* CREATE A NEW STRUCT FOR THE OUT STUB */
+                new_node = (struct stub_node*)malloc(sizeof( struct stub_node )); 
+                new_node -> farm_id = e->DayMoves.src_farm[i] ; /*source farm*/
+                new_node -> batch_type = e->DayMoves.batch_type[i] ;
+                new_node -> taken = 0 ;
+                new_node -> next_node = NULL;   
+               
+                /* ADD THE NEW NODE TO THE BUCKET OF ITS STRATUM AND GROW THE BUCKET'S BOUNDING BOX*/
+                src_farm_id = e->DayMoves.src_farm[i];
+                find_bucket = find_stub_bucket(day_slot,
+                                stub_key(e->DayMoves.batch_type[i],
+                                         (e->opts.strat_island == 1) ? FarmData->island[src_farm_id] : STUB_KEY_ANY,
+                                         (e->opts.strat_dca == 1) ? dca_code(FarmData->testarea[src_farm_id]) : STUB_KEY_ANY), 1);
+                 add_node_to_day(&find_bucket->head, 0, new_node ) ;
+                 find_bucket->count++;
+                 extend_bucket_box(find_bucket, FarmData->x_coord[src_farm_id], FarmData->y_coord[src_farm_id]);
+                 
+           } 
+          }
+
+     while ((match_day = first_pending_day(outstubs_day, day_window)) != -1
+            && (stream_done == 1 || match_day + days_ahead <= current_day - 1 + phase))
+     {
+          day_slot = &outstubs_day[match_day % day_window];
+          PendMoves = &day_slot->moves;
+          num_day_moves = PendMoves->num_moves;
+          day_slot->pending = 0;
+
+          /* DAYS BEFORE THE WINDOW OF match_day ARE NOT NEEDED ANY MORE*/
+          for (i = 0; i < day_window; i++)
+          {
+              if (outstubs_day[i].day != -1 && outstubs_day[i].day < match_day - error_range_day_movement)
+              {
+              stats->unmatched = stats->unmatched + retire_day(e, &outstubs_day[i], count_iter);
+              }
+          }
+
+          /* ENGINE 1: SOLVE THE DAY FIRST, LOOP B THEN ONLY STORES THE RESULT. The outward stubs of the
+             pending days within error_range_day_movement after match_day compete for the same inward stubs,
+             so they are solved with it; only the result of match_day is kept, the later days are solved again in turn*/
+          if (e->config.match_engine == 1)
+          {
+              copy_moves(&e->WinMoves, &e->win_capacity, 0, PendMoves);
+              num_rows = num_day_moves;
+              for (d = match_day + 1; d <= match_day + error_range_day_movement; d++)
+              {
+                  if (outstubs_day[d % day_window].day == d && outstubs_day[d % day_window].pending == 1)
+                  {
+                  copy_moves(&e->WinMoves, &e->win_capacity, num_rows, &outstubs_day[d % day_window].moves);
+                  num_rows = num_rows + outstubs_day[d % day_window].moves.num_moves;
+                  }
+              }
+              if (num_rows > e->day_capacity)
+              {
+              e->day_capacity = num_rows;
+              e->day_selected_dis = (int*)realloc(e->day_selected_dis, sizeof(int) * e->day_capacity);
+              e->day_best_node = (struct stub_node**)realloc(e->day_best_node, sizeof(struct stub_node*) * e->day_capacity);
+              e->day_best_bucket = (struct stub_bucket**)realloc(e->day_best_bucket, sizeof(struct stub_bucket*) * e->day_capacity);
+              e->day_best_day = (int*)realloc(e->day_best_day, sizeof(int) * e->day_capacity);
+              }
+              for (i = 0; i < num_rows; i++)
+              {
+              e->day_selected_dis[i] = (e->Moves.pred_file != NULL) ? e->WinMoves.selected_dis[i]
+                                       : e->CovPredData[e->WinMoves.move_id[i] * e->pred_stride + count_iter];
+              }
+              assign_day(&e->WinMoves, num_rows, num_day_moves, e->day_selected_dis, outstubs_day, FarmData, e->dis_matrix, &e->opts,
+                         e->day_best_node, e->day_best_bucket, e->day_best_day);
+          }
+
+    for (batch = 0; batch < num_day_moves ; batch++) //batch is counter to count and look each batch of the day from the top
+
+    { 
+        
+	best_node = NULL; // Initialise the indicator if best node is found or not
+
+        min_diff = 9999; // Initialise the minimum distance found between the outward and candidate inward to 9999, which is longer than possible between farm distance in NZ
+ 
+        des_farm_id = PendMoves->des_farm[batch]; 
+        batch_this_move = PendMoves->batch_type[batch]; //batch type of this batch
+        day_this_move = match_day ; //day of movement
+      move_id_this_move = PendMoves->move_id[batch] ; //id that links this batch to the predicted distance 
+      des_testarea = FarmData->testarea[des_farm_id] ; //testarea of destination farm
+      selected_dis = (e->Moves.pred_file != NULL) ? PendMoves->selected_dis[batch] : e->CovPredData[move_id_this_move * e->pred_stride + count_iter] ; // get the predicted distance for this batch
+      
+     
+/* 3.3 SEARCH FOR INWARD STUBS AS FOLLOWS.
+      1. First check the buckets of this day that the destination may take stubs from (same batch type and, when stratified, same island and allowed DCA combination). Get the best farm.
+      2. If the identified distance difference is not 0 (i.e. there is possibility that other inward on other candidate days can be better), then move to the same buckets of the other days.
+      A bucket whose bounding box shows it can not beat min_diff is skipped without visiting its stubs.*/
+      best_bucket = NULL;
+      if (e->config.match_engine == 1) // already assigned for the day
+      {
+      best_node = e->day_best_node[batch];
+      best_bucket = e->day_best_bucket[batch];
+      day_to_delete = e->day_best_day[batch];
+      min_diff = 0; // nothing to search
+      }
+      num_keys = destination_stub_keys(batch_this_move, FarmData->island[des_farm_id], des_testarea, e->opts.strat_island, e->opts.strat_dca, e->opts.allowed_dca, search_keys);
+
+     /*3.3.1. On the observed movement day (offset 0), 3.3.2. then days within the specified range, only while min_diff != 0*/
+      for (i = 0; i < e->opts.num_day_offsets && min_diff != 0; i++)
+      {
+          search_day = day_this_move + array_ordered_day[i];
+          if (search_day >= 0 && outstubs_day[search_day % day_window].day == search_day) // only days still held in the window
+          {
+              for (h = 0; h < num_keys && min_diff != 0; h++)
+              {
+                  find_bucket = find_stub_bucket(&outstubs_day[search_day % day_window], search_keys[h], 0);
+                  if (find_bucket == NULL || find_bucket->count == 0)
+                  {
+                  continue;
+                  }
+                  if (e->config.prune_buckets == 1 && bucket_lower_bound(find_bucket, FarmData->x_coord[des_farm_id], FarmData->y_coord[des_farm_id], selected_dis, &e->opts) >= min_diff)
+                  {
+                  stats->skipped++;
+                  continue;
+                  }
+                  if (scan_stub_bucket(find_bucket, des_farm_id, selected_dis, e->dis_matrix, &min_diff, &best_node) == 1)
+                  {
+                  best_bucket = find_bucket;
+                  day_to_delete = search_day;
+                  }
+              }
+          }
+      }
+         
+
+ /* 3.4. STORE THE INSTUB DATA - MAKE SURE SAVE THESE DATA BEFORE DELETING THE NODE*/        
+       if (best_node != NULL) // only if outward stubs found their partners
+       {
+       src_farm_id = best_node -> farm_id ;
+       dis_src_des = e->dis_matrix[src_farm_id][des_farm_id];
+       stats->matched++;
+       stats->cost = stats->cost + abs(selected_dis - dis_src_des);
+       count_move(e, count_iter + 1, src_farm_id, des_farm_id, batch_this_move, 1);
+           
+       if (e->on_match != NULL)
+          {
+          match.count_iter = count_iter;
+          match.src_farm = src_farm_id;
+          match.des_farm = des_farm_id;
+          match.day = day_this_move;
+          match.src_day = day_to_delete;
+          match.batch_type = batch_this_move;
+          match.distance = dis_src_des;
+          e->on_match(&match, e->user);
+          }
+
+/* 3.5. DELETE IDENTIFIED STUBS FROM THE INSTUB LISTS*/
+       remove_node_from_day(&best_bucket->head, 0, best_node);
+       best_bucket->count--;
+       }
+   
+   } //########################### LOOP B ENDS HERE.
+     } // pending day ends
+     } // phase ends
+    } // stream ends
+   
+      /* Whatever is still in the window at the end of the horizon is unmatched*/
+      for (i = 0 ; i < day_window; i++)
+      {
+          if (outstubs_day[i].day != -1)
+          {
+          stats->unmatched = stats->unmatched + retire_day(e, &outstubs_day[i], count_iter);
+          }
+          }
+     return (0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* CLEAR DYNAMICALLY ALLOCATED MEMORY OF THE ENGINE (caller arrays are left alone) */
+/* -------------------------------------------------------------------------- */
+void rewire_destroy(struct rewire_engine *e)
+{
+  int i;
+
+  for (i = 0; i < e->opts.day_window; i++)
+     {
+        free(e->outstubs_day[i].table);
+        free(e->outstubs_day[i].moves.src_farm);
+        free(e->outstubs_day[i].moves.des_farm);
+        free(e->outstubs_day[i].moves.move_id);
+        free(e->outstubs_day[i].moves.day);
+        free(e->outstubs_day[i].moves.batch_type);
+        free(e->outstubs_day[i].moves.selected_dis);
+     }
+  free(e->outstubs_day);
+  free(e->array_ordered_day);
+  free(e->move_order);
+  free(e->DayMoves.src_farm);
+  free(e->DayMoves.des_farm);
+  free(e->DayMoves.move_id);
+  free(e->DayMoves.day);
+  free(e->DayMoves.batch_type);
+  free(e->DayMoves.selected_dis);
+  free(e->WinMoves.src_farm);
+  free(e->WinMoves.des_farm);
+  free(e->WinMoves.move_id);
+  free(e->WinMoves.day);
+  free(e->WinMoves.batch_type);
+  free(e->WinMoves.selected_dis);
+  free(e->day_selected_dis);
+  free(e->day_best_node);
+  free(e->day_best_bucket);
+  free(e->day_best_day);
+  if (e->dis_matrix != NULL)
+     {
+        free(e->dis_matrix[0]);
+        free(e->dis_matrix);
+     }
+  unmap_road_distances(&e->road);
+  free(e);
+}
+/* END OF ENGINE API*/
+
+ 
+/* ########################################################################## */
+/* FUNCTION CODE */
+
+/* -------------------------------------------------------------------------- */
+/* rewire_read_farm_data: READING AND PARSING CSV FARM LIST */
+/* -------------------------------------------------------------------------- */
+void rewire_read_farm_data(char FarmDataFile[], struct farm_table *FarmData, long int num_farms)
+{     
+    /* OPEN INPUT FILE */
+    FILE *Farms = fopen(FarmDataFile,"r"); 
+       
+    /* DECLARE STORAGE VARIABLES */
+    long int line_num;
+    int island;
+    double x_coord, y_coord, farm_id, testarea;
+    
+    /* READ LINES OF FARM FILE */
+    for(line_num = 0; line_num < num_farms; line_num++)
+      { 
+         fscanf(Farms, "%lf,%lf,%lf, %lf, %d", &farm_id, &x_coord, &y_coord, &testarea, &island );
+
+         /* STORE VALUES IN FARM LIST */
+             FarmData->farm_id[line_num] = (int32_t)farm_id;
+             FarmData->x_coord[line_num] = x_coord;
+             FarmData->y_coord[line_num] = y_coord;
+             FarmData->testarea[line_num] = (uint8_t)testarea;
+             FarmData->island[line_num] = (uint8_t)island;
+      }            
+   
+   /* CLOSE INPUT FILE */
+   fclose(Farms);
+   
+} 
+/* -------------------------------------------------------------------------- */
+
+/*-----------------------------------------------------------------------------*/
+/* rewire_read_movement_data: READING AND PARSING CSV Movement LIST.
+/* -------------------------------------------------------------------------- */
+void rewire_read_movement_data(char MoveDataFile[], struct move_table *MoveData, long int num_moves)
+{     
+    /* OPEN INPUT FILE */
+    FILE *Moves = fopen(MoveDataFile,"r"); 
+       
+    /* DECLARE STORAGE VARIABLES */
+    long int line_num;
+    double src_farm, des_farm, day, batch_cat, move_id;
+    
+    /* READ LINES OF FARM FILE */
+    for(line_num = 0; line_num < num_moves; line_num++)
+      { 
+         fscanf(Moves, "%lf,%lf,%lf,%lf,%lf",&src_farm, &des_farm, &day,&batch_cat,&move_id);
+
+         /* STORE VALUES IN FARM LIST */
+             MoveData->src_farm[line_num] = (int32_t)src_farm;
+             MoveData->des_farm[line_num] = (int32_t)des_farm;
+             MoveData->day[line_num] = (uint16_t)day;
+             MoveData->batch_type[line_num] = (uint8_t)batch_cat;
+             MoveData->move_id[line_num] = (int32_t)move_id;
+
+
+      }            
+   
+   /* CLOSE INPUT FILE */
+   fclose(Moves);
+   
+} 
+/*-----------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------*/
+/* Read covariate pattern that associates predicted distance.
+/* -------------------------------------------------------------------------- */
+void rewire_read_distance_intervals(char DistanceIntervalFile[], uint16_t *CovPredData, int num_covs, int num_simu)
+{     
+    /* OPEN INPUT FILE */
+    FILE *DisInt = fopen(DistanceIntervalFile,"r"); 
+       
+    /* DECLARE STORAGE VARIABLES */
+    int line_num, col_num, d;
+    
+    /* READ LINES OF FARM FILE */
+    for(line_num = 0; line_num < num_covs; line_num++)
+      { 
+       for(col_num = 0; col_num < num_simu; col_num++)
+       {
+         fscanf(DisInt, "%d,", &d); // fscanf is not reading a whole line, but only one value??
+          CovPredData[(long int)line_num * num_simu + col_num] = (uint16_t)d;
+          
+       }
+       }
+         
+   /* CLOSE INPUT FILE */
+   fclose(DisInt);
+   
+} 
+/*-----------------------------------------------------------------------------*/
+
+
+
+/*-----------------------------------------------------------------------------*/
+/* Calculate distance between two points.
+Input is double and output is int*/
+/*-----------------------------------------------------------------------------*/
+double rewire_calc_dis(double src_x, double src_y, double des_x, double des_y)
+{
+     int distance_x_y;
+     distance_x_y = (int)(roundf(sqrt((src_x - des_x)*(src_x - des_x) + (src_y - des_y)*(src_y - des_y))/1000)) ;
+     return(distance_x_y) ;
+}
+
+/*-----------------------------------------------------------------------------*/
+
+/* -------------------------------------------------------------------------- */
+/* Sorting function*/
+/* -------------------------------------------------------------------------- */
+
+   /*Sort by random number of movements*/
+static int comp_random(const void* a, const void* b) 
+       {
+         const struct move_sort_key *p1 = (const struct move_sort_key*)a;
+         const struct move_sort_key *p2 = (const struct move_sort_key*)b;
+
+         /* SORT BY Day, then random number ASCENDING (packed into key as day << 32 | random) */
+         if (p1->key < p2->key) return -1;
+         if (p1->key > p2->key) return 1;
+         return 0;
+  }
+/* -------------------------------------------------------------------------- */     
+
+/* -------------------------------------------------------------------------- */
+/* add_stub: ADD MOVEMENT TO FARM LIST */
+/* -------------------------------------------------------------------------- */
+static void add_node_to_day(struct stub_node *day_list[], int day, struct stub_node *node_to_add )
+{     
+
+ struct stub_node *current_node1;
+ current_node1 = day_list[day];
+ if(current_node1 == NULL)
+    {
+        day_list[day] = node_to_add;
+    }
+ else
+    {
+       node_to_add -> next_node = current_node1;
+       day_list[day] = node_to_add;
+    }
+
+}
+
+/*----------------------------------------------------------------------------*/
+/* RANDOM NUMBER GENERATOR FUNCTION*/
+/*-----------------------------------------------------------------------------*/
+static unsigned int rand_interval(unsigned int min, unsigned int max)
+{
+    int r;
+    const unsigned int range = 1 + max - min;
+    const unsigned int buckets = RAND_MAX / range;
+    const unsigned int limit = buckets * range;
+    
+    do
+    { 
+        r = rand();
+    } while (r >= limit);
+
+    return min + (r / buckets);
+}
+
+/*------------------------------------------------------------------------------*/
+/* -------------------------------------------------------------------------- */
+/* REMOVE A NODE FROM THE LIST */
+/* -------------------------------------------------------------------------- */
+static int remove_node_from_day(struct stub_node *day_list[], int day, struct stub_node *node_to_remove)
+{
+  
+  if (day_list[day] != NULL)
+  {
+    struct stub_node *prev_node1;
+    struct stub_node *current_node1;
+  
+    prev_node1 = day_list[day];
+    current_node1 = day_list[day];
+    while(current_node1 != NULL)
+      {
+         if(current_node1 == node_to_remove)
+           {
+                if(current_node1 == day_list[day])
+                 {
+                    day_list[day] = current_node1 -> next_node;
+                    free(current_node1);
+                    return (0);
+                 }
+                else
+                 {
+                  prev_node1 -> next_node = current_node1 -> next_node;                   
+                  free(current_node1);
+                  return (0);
+
+                 }
+           }
+         else
+           {
+              prev_node1 = current_node1;
+              current_node1 = current_node1 -> next_node;  
+           }
+      }            
+
+      return (0);
+   }
+   
+   return (0);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* RETIRE A DAY THAT LEFT THE WINDOW: REPORT AND FREE ITS REMAINING STUBS.
+Returns the number of stubs that were left unmatched. */
+/* -------------------------------------------------------------------------- */
+static int retire_day(struct rewire_engine *e, struct day_buckets *day_slot, long int count_iter)
+{
+  struct stub_node *current_node1;
+  struct stub_node *next_node1;
+  int num_left = 0;
+  int b;
+
+  for (b = 0; b < day_slot->capacity; b++)
+     {
+        if (day_slot->table[b].key == STUB_KEY_EMPTY)
+           {
+              continue;
+           }
+        current_node1 = day_slot->table[b].head;
+        while(current_node1 != NULL)
+           {
+              if (e->on_unmatched != NULL)
+                 {
+                    e->on_unmatched(count_iter, day_slot->day, current_node1 -> farm_id, current_node1 -> batch_type, e->user);
+                 }
+              next_node1 = current_node1 -> next_node;
+              free(current_node1);
+              num_left++;
+              current_node1 = next_node1;
+           }
+        day_slot->table[b].key = STUB_KEY_EMPTY;
+        day_slot->table[b].count = 0;
+        day_slot->table[b].head = NULL;
+     }
+  day_slot->num_used = 0;
+  day_slot->day = -1;
+  return (num_left);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* STRATIFICATION KEYS OF THE STUB BUCKETS */
+/* -------------------------------------------------------------------------- */
+/* DCA status as 0-4, unknown (99 or anything else) as 5*/
+static int dca_code(int testarea)
+{
+  if (testarea >= 0 && testarea < NUM_DCA_CODES - 1)
+     {
+        return (testarea);
+     }
+  return (NUM_DCA_CODES - 1);
+}
+
+/* Composite key of a bucket; island and dca are STUB_KEY_ANY when not stratified*/
+static uint32_t stub_key(int batch_type, int island, int dca)
+{
+  return (((uint32_t)(batch_type & 0xFF) << 16) | ((uint32_t)(island & 0xFF) << 8) | (uint32_t)(dca & 0xFF));
+}
+
+/* Fill keys[] with the buckets a destination may take stubs from. Returns the number of keys*/
+static int destination_stub_keys(int batch_type, int des_island, int des_testarea, int strat_island, int strat_dca, int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES], uint32_t keys[])
+{
+  int island = (strat_island == 1) ? des_island : STUB_KEY_ANY;
+  int des_dca = dca_code(des_testarea);
+  int src_dca;
+  int num_keys = 0;
+
+  if (strat_dca == 0)
+     {
+        keys[0] = stub_key(batch_type, island, STUB_KEY_ANY);
+        return (1);
+     }
+  for (src_dca = 0; src_dca < NUM_DCA_CODES; src_dca++)
+     {
+        if (allowed_dca[src_dca][des_dca] == 1)
+           {
+              keys[num_keys] = stub_key(batch_type, island, src_dca);
+              num_keys++;
+           }
+     }
+  return (num_keys);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* BUCKET SUMMARIES: BOUNDING BOX OF THE SOURCE FARMS */
+/* -------------------------------------------------------------------------- */
+static void extend_bucket_box(struct stub_bucket *bucket, double x, double y)
+{
+  if (x < bucket->min_x) bucket->min_x = x;
+  if (x > bucket->max_x) bucket->max_x = x;
+  if (y < bucket->min_y) bucket->min_y = y;
+  if (y > bucket->max_y) bucket->max_y = y;
+}
+
+/* Smallest |selected_dis - distance| any stub of the bucket can give to a
+destination at (des_x, des_y). The box only grows, so it stays a valid bound
+after stubs are deleted. Distances are rounded km as in rewire_calc_dis.
+A road distance can be much longer than the far corner of the box but not
+(more than road_slack) shorter than the straight line, so with road distances
+only the near side bounds the bucket.*/
+static int bucket_lower_bound(struct stub_bucket *bucket, double des_x, double des_y, int selected_dis, const struct match_options *opts)
+{
+  double dx_near = (des_x < bucket->min_x) ? bucket->min_x - des_x : ((des_x > bucket->max_x) ? des_x - bucket->max_x : 0);
+  double dy_near = (des_y < bucket->min_y) ? bucket->min_y - des_y : ((des_y > bucket->max_y) ? des_y - bucket->max_y : 0);
+  double dx_far = fmax(fabs(des_x - bucket->min_x), fabs(des_x - bucket->max_x));
+  double dy_far = fmax(fabs(des_y - bucket->min_y), fabs(des_y - bucket->max_y));
+  int dis_near = (int)floor(sqrt(dx_near * dx_near + dy_near * dy_near) / 1000);
+  int dis_far = (int)ceil(sqrt(dx_far * dx_far + dy_far * dy_far) / 1000);
+
+  if (opts->road_distances == 1)
+     {
+        dis_near = dis_near - opts->road_slack;
+        return ((selected_dis < dis_near) ? dis_near - selected_dis : 0);
+     }
+  if (selected_dis < dis_near)
+     {
+        return (dis_near - selected_dis);
+     }
+  if (selected_dis > dis_far)
+     {
+        return (selected_dis - dis_far);
+     }
+  return (0);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* find_stub_bucket: LOOK UP THE BUCKET OF key IN A DAY (LINEAR PROBING).
+If create is 1, a missing bucket is added; otherwise NULL is returned. */
+/* -------------------------------------------------------------------------- */
+static struct stub_bucket *find_stub_bucket(struct day_buckets *day_slot, uint32_t key, int create)
+{
+  int b, mask;
+
+  if (day_slot->capacity == 0)
+     {
+        if (create == 0)
+           {
+              return (NULL);
+           }
+        day_slot->capacity = 16;
+        day_slot->num_used = 0;
+        day_slot->table = (struct stub_bucket*)malloc(sizeof(struct stub_bucket) * day_slot->capacity);
+        for (b = 0; b < day_slot->capacity; b++)
+           {
+              day_slot->table[b].key = STUB_KEY_EMPTY;
+              day_slot->table[b].count = 0;
+              day_slot->table[b].head = NULL;
+           }
+     }
+
+  mask = day_slot->capacity - 1;
+  b = (int)((key * 2654435761u) >> 8) & mask;
+  while (day_slot->table[b].key != STUB_KEY_EMPTY)
+     {
+        if (day_slot->table[b].key == key)
+           {
+              return (&day_slot->table[b]);
+           }
+        b = (b + 1) & mask;
+     }
+  if (create == 0)
+     {
+        return (NULL);
+     }
+
+  /* KEEP THE TABLE AT MOST HALF FULL: DOUBLE AND REHASH, THEN INSERT*/
+  if ((day_slot->num_used + 1) * 2 > day_slot->capacity)
+     {
+        struct stub_bucket *old_table = day_slot->table;
+        int old_capacity = day_slot->capacity;
+        int k;
+        day_slot->capacity = old_capacity * 2;
+        day_slot->table = (struct stub_bucket*)malloc(sizeof(struct stub_bucket) * day_slot->capacity);
+        for (b = 0; b < day_slot->capacity; b++)
+           {
+              day_slot->table[b].key = STUB_KEY_EMPTY;
+              day_slot->table[b].count = 0;
+              day_slot->table[b].head = NULL;
+           }
+        mask = day_slot->capacity - 1;
+        for (k = 0; k < old_capacity; k++)
+           {
+              if (old_table[k].key != STUB_KEY_EMPTY)
+                 {
+                    b = (int)((old_table[k].key * 2654435761u) >> 8) & mask;
+                    while (day_slot->table[b].key != STUB_KEY_EMPTY)
+                       {
+                          b = (b + 1) & mask;
+                       }
+                    day_slot->table[b] = old_table[k];
+                 }
+           }
+        free(old_table);
+        b = (int)((key * 2654435761u) >> 8) & mask;
+        while (day_slot->table[b].key != STUB_KEY_EMPTY)
+           {
+              b = (b + 1) & mask;
+           }
+     }
+  day_slot->table[b].key = key;
+  day_slot->table[b].count = 0;
+  day_slot->table[b].head = NULL;
+  day_slot->table[b].min_x = day_slot->table[b].min_y = HUGE_VAL;
+  day_slot->table[b].max_x = day_slot->table[b].max_y = -HUGE_VAL;
+  day_slot->num_used++;
+  return (&day_slot->table[b]);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* scan_stub_bucket: FIND THE STUB IN A BUCKET WHOSE DISTANCE TO THE DESTINATION
+IS CLOSEST TO selected_dis. min_diff and best_node are overwritten only by a
+strictly better stub; returns 1 if that happened. */
+/* -------------------------------------------------------------------------- */
+static int scan_stub_bucket(struct stub_bucket *bucket, int des_farm_id, int selected_dis, uint16_t **dis_matrix, int *min_diff, struct stub_node **best_node)
+{
+  struct stub_node *find_node;
+  int dis_diff;
+  int improved = 0;
+
+  for (find_node = bucket->head; find_node != NULL; find_node = find_node -> next_node)
+     {
+        if (find_node -> farm_id == des_farm_id) //the source and destination farm should be different
+           {
+              continue;
+           }
+        /*Calclulate the difference in distance between the chosen random value and the distance to this inward*/
+        dis_diff = abs(selected_dis - dis_matrix[find_node -> farm_id][des_farm_id]);
+        if (dis_diff < *min_diff)
+           {
+              *min_diff = dis_diff;
+              *best_node = find_node;
+              improved = 1;
+              if (dis_diff == 0)
+                 {
+                    break; //Once the distance diffference reaches 0, stop searching anymore
+                 }
+           }
+     }
+  return (improved);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* ASSIGNMENT ENGINE (match_engine = 1)
+The outward stubs of the day being rewired and of the pending days up to
+error_range_day_movement after it are split into blocks that may take stubs
+from the same buckets: same batch type and, when stratified, same island and
+DCA. Each block is solved as a min-cost assignment of |selected_dis - distance|
+over the inward stubs of the days it covers, every outward stub only paired
+with the stubs of its own day window. Only the pairs of the day being rewired
+are kept; the later days are solved again when their turn comes (rolling
+window), so the days whose windows overlap share their inward stubs instead of
+each day using up its own. An outward stub left unmatched costs
+assign_unmatched_cost; at its default every stub that can be matched is, which
+with a window before the movement only keeps each day to its own stubs.
+Each destination keeps only its assign_candidates cheapest stubs, and the
+assignment is solved on that sparse graph by shortest augmenting paths, so no
+n x m cost matrix is ever built: a block costs O(n x m) time to scan and
+O(n x assign_candidates) memory. A block where cutting pairs left a stub
+unmatched is solved again with twice as many, up to all of them.
+Compiled with -fopenmp, the batch type (and island) segments, whose buckets
+are disjoint, are solved in parallel; a day with a single segment splits the
+scan of its candidate pairs over the destinations instead. */
+/* -------------------------------------------------------------------------- */
+
+/* GROW THE WORKSPACE FOR n DESTINATIONS, m CANDIDATE STUBS AND num_edges CANDIDATE PAIRS*/
+static void reserve_assign_workspace(struct assign_workspace *w, long int n, long int m, long int num_edges)
+{
+  long int cols = m + n + 1;
+
+  if (cols > w->cap_cols)
+     {
+        w->cap_cols = cols * 2;
+        w->col_node = (struct stub_node**)realloc(w->col_node, sizeof(struct stub_node*) * w->cap_cols);
+        w->col_bucket = (struct stub_bucket**)realloc(w->col_bucket, sizeof(struct stub_bucket*) * w->cap_cols);
+        w->col_day = (int*)realloc(w->col_day, sizeof(int) * w->cap_cols);
+        w->v = (int64_t*)realloc(w->v, sizeof(int64_t) * w->cap_cols);
+        w->dist = (int64_t*)realloc(w->dist, sizeof(int64_t) * w->cap_cols);
+        w->p = (int*)realloc(w->p, sizeof(int) * w->cap_cols);
+        w->way = (int*)realloc(w->way, sizeof(int) * w->cap_cols);
+        w->done = (char*)realloc(w->done, sizeof(char) * w->cap_cols);
+        w->touched = (int*)realloc(w->touched, sizeof(int) * w->cap_cols);
+     }
+  if (n + 1 > w->cap_rows)
+     {
+        w->cap_rows = (n + 1) * 2;
+        w->u = (int64_t*)realloc(w->u, sizeof(int64_t) * w->cap_rows);
+        w->row_dist = (int64_t*)realloc(w->row_dist, sizeof(int64_t) * w->cap_rows);
+        w->row_col = (int*)realloc(w->row_col, sizeof(int) * w->cap_rows);
+        w->row_start = (long int*)realloc(w->row_start, sizeof(long int) * w->cap_rows);
+        w->row_edges = (long int*)realloc(w->row_edges, sizeof(long int) * w->cap_rows);
+        w->row_valid = (long int*)realloc(w->row_valid, sizeof(long int) * w->cap_rows);
+     }
+  if (num_edges > w->cap_edges)
+     {
+        w->cap_edges = num_edges * 2;
+        w->edge_col = (int*)realloc(w->edge_col, sizeof(int) * w->cap_edges);
+        w->edge_cost = (int32_t*)realloc(w->edge_cost, sizeof(int32_t) * w->cap_edges);
+     }
+}
+
+static void free_assign_workspace(struct assign_workspace *w)
+{
+  free(w->col_node); free(w->col_bucket); free(w->col_day);
+  free(w->row_start); free(w->row_edges); free(w->row_valid); free(w->edge_col); free(w->edge_cost);
+  free(w->u); free(w->v); free(w->dist); free(w->row_dist); free(w->p); free(w->way); free(w->row_col);
+  free(w->done); free(w->touched); free(w->heap_dist); free(w->heap_col);
+}
+
+/* k-th smallest value (0-based) of buf[0..n-1]; buf is reordered*/
+static int kth_smallest(int *buf, int n, int k)
+{
+  int lo = 0, hi = n - 1;
+  while (lo < hi)
+     {
+        int pivot = buf[(lo + hi) / 2];
+        int i = lo, j = hi, tmp;
+        while (i <= j)
+           {
+              while (buf[i] < pivot) i++;
+              while (buf[j] > pivot) j--;
+              if (i <= j)
+                 {
+                    tmp = buf[i]; buf[i] = buf[j]; buf[j] = tmp;
+                    i++; j--;
+                 }
+           }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else return (buf[k]);
+     }
+  return (buf[k]);
+}
+
+/* MIN-HEAP OF (distance, column) FOR THE SHORTEST PATH SEARCH*/
+static void heap_push(struct assign_workspace *w, long int *size, int64_t d, int c)
+{
+  long int k = *size, parent;
+
+  if (k + 1 > w->cap_heap)
+     {
+        w->cap_heap = (k + 1) * 2;
+        w->heap_dist = (int64_t*)realloc(w->heap_dist, sizeof(int64_t) * w->cap_heap);
+        w->heap_col = (int*)realloc(w->heap_col, sizeof(int) * w->cap_heap);
+     }
+  while (k > 0 && w->heap_dist[parent = (k - 1) / 2] > d)
+     {
+        w->heap_dist[k] = w->heap_dist[parent];
+        w->heap_col[k] = w->heap_col[parent];
+        k = parent;
+     }
+  w->heap_dist[k] = d;
+  w->heap_col[k] = c;
+  (*size)++;
+}
+
+static int heap_pop(struct assign_workspace *w, long int *size, int64_t *d)
+{
+  int c = w->heap_col[0];
+  int64_t last_dist = w->heap_dist[*size - 1];
+  int last_col = w->heap_col[*size - 1];
+  long int k = 0, child;
+
+  *d = w->heap_dist[0];
+  (*size)--;
+  while ((child = 2 * k + 1) < *size)
+     {
+        if (child + 1 < *size && w->heap_dist[child + 1] < w->heap_dist[child])
+           {
+              child++;
+           }
+        if (w->heap_dist[child] >= last_dist)
+           {
+              break;
+           }
+        w->heap_dist[k] = w->heap_dist[child];
+        w->heap_col[k] = w->heap_col[child];
+        k = child;
+     }
+  w->heap_dist[k] = last_dist;
+  w->heap_col[k] = last_col;
+  return (c);
+}
+
+/* Relax the candidate pairs of row r, reached at distance d, and its own "unmatched" column*/
+static void relax_row(struct assign_workspace *w, int r, int m, int64_t d, long int *heap_size, long int *num_touched)
+{
+  long int k;
+  int c;
+  int32_t cost;
+  int64_t nd;
+
+  for (k = w->row_start[r]; k <= w->row_start[r+1]; k++)
+     {
+        if (k < w->row_start[r+1])
+           {
+              c = w->edge_col[k];
+              cost = w->edge_cost[k];
+           }
+        else
+           {
+              c = m + r;
+              cost = w->unmatched_cost;
+           }
+        if (w->done[c] == 1)
+           {
+              continue;
+           }
+        nd = d + cost - w->u[r] - w->v[c];
+        if (nd < w->dist[c])
+           {
+              if (w->dist[c] == INT64_MAX)
+                 {
+                    w->touched[(*num_touched)++] = c;
+                 }
+              w->dist[c] = nd;
+              w->way[c] = r;
+              heap_push(w, heap_size, nd, c);
+           }
+     }
+}
+
+/* Min-cost assignment on the sparse graph of w (row_start/edge_col/edge_cost) with
+n rows and m stub columns, by successive shortest augmenting paths with
+potentials (Dijkstra over the candidate pairs only). Every row also has a
+column m + r of its own at cost w->unmatched_cost, so it can stay unmatched;
+at ASSIGN_FORBIDDEN the number of matches is maximised first, then the cost minimised.
+w->row_col[r] receives the column given to row r.*/
+static void solve_assignment(struct assign_workspace *w, int n, int m)
+{
+  long int k, heap_size, num_touched;
+  int i, c, r, sink, previous, lowest_col;
+  int64_t d, d_sink, lowest;
+
+  for (c = 0; c < m + n; c++)
+     {
+        w->v[c] = 0;
+        w->p[c] = -1;
+        w->dist[c] = INT64_MAX;
+        w->done[c] = 0;
+     }
+  for (i = 0; i < n; i++)
+     {
+        /* A new row has no incoming pair: any potential keeping its reduced costs >= 0 will do*/
+        lowest = w->unmatched_cost - w->v[m + i];
+        lowest_col = m + i;
+        for (k = w->row_start[i]; k < w->row_start[i+1]; k++)
+           {
+              if (w->edge_cost[k] - w->v[w->edge_col[k]] < lowest)
+                 {
+                    lowest = w->edge_cost[k] - w->v[w->edge_col[k]];
+                    lowest_col = w->edge_col[k];
+                 }
+           }
+        w->u[i] = lowest;
+
+        /* A FREE COLUMN AT REDUCED COST 0 IS A SHORTEST PATH BY ITSELF (the usual case)*/
+        if (w->p[lowest_col] == -1)
+           {
+              w->p[lowest_col] = i;
+              w->row_col[i] = lowest_col;
+              continue;
+           }
+
+        /* SHORTEST PATH FROM ROW i TO A FREE COLUMN; ITS OWN UNMATCHED COLUMN IS ALWAYS FREE*/
+        heap_size = 0;
+        num_touched = 0;
+        w->row_dist[i] = 0;
+        relax_row(w, i, m, 0, &heap_size, &num_touched);
+        sink = -1;
+        d_sink = 0;
+        while (sink == -1)
+           {
+              c = heap_pop(w, &heap_size, &d);
+              if (w->done[c] == 1 || d > w->dist[c])
+                 {
+                    continue; // stale entry
+                 }
+              w->done[c] = 1;
+              if (w->p[c] == -1)
+                 {
+                    sink = c;
+                    d_sink = d;
+                 }
+              else
+                 {
+                    r = w->p[c];
+                    w->row_dist[r] = d; // the pair holding c has reduced cost 0
+                    relax_row(w, r, m, d, &heap_size, &num_touched);
+                 }
+           }
+
+        /* POTENTIALS: nodes settled before the sink move by their distance; the rest stay (a common shift)*/
+        w->u[i] = w->u[i] + d_sink;
+        for (k = 0; k < num_touched; k++)
+           {
+              c = w->touched[k];
+              if (w->done[c] == 1 && c != sink)
+                 {
+                    w->v[c] = w->v[c] + w->dist[c] - d_sink;
+                    w->u[w->p[c]] = w->u[w->p[c]] + d_sink - w->row_dist[w->p[c]];
+                 }
+           }
+
+        /* AUGMENT ALONG THE PATH*/
+        c = sink;
+        while (1)
+           {
+              r = w->way[c];
+              previous = w->row_col[r];
+              w->p[c] = r;
+              w->row_col[r] = c;
+              if (r == i)
+                 {
+                    break;
+                 }
+              c = previous;
+           }
+
+        for (k = 0; k < num_touched; k++)
+           {
+              w->dist[w->touched[k]] = INT64_MAX;
+              w->done[w->touched[k]] = 0;
+           }
+     }
+}
+
+/* Add the stubs of search_day not taken yet in the buckets keys[] as columns*/
+static int add_block_columns(struct assign_workspace *w, int n, int m, int search_day, const uint32_t *keys, int num_keys,
+                             struct day_buckets *outstubs_day, const struct match_options *opts)
+{
+  int h;
+  struct stub_bucket *bucket;
+  struct stub_node *node;
+  struct day_buckets *day_slot;
+
+  if (search_day < 0 || outstubs_day[search_day % opts->day_window].day != search_day)
+     {
+        return (m);
+     }
+  day_slot = &outstubs_day[search_day % opts->day_window];
+  for (h = 0; h < num_keys; h++)
+     {
+        bucket = find_stub_bucket(day_slot, keys[h], 0);
+        if (bucket == NULL)
+           {
+              continue;
+           }
+        for (node = bucket->head; node != NULL; node = node -> next_node)
+           {
+              if (node -> taken == 0)
+                 {
+                    reserve_assign_workspace(w, n, m + 1, 0);
+                    w->col_node[m] = node;
+                    w->col_bucket[m] = bucket;
+                    w->col_day[m] = search_day;
+                    m++;
+                 }
+           }
+     }
+  return (m);
+}
+
+/* Candidate pairs of the block: the keep cheapest stubs of each destination within its own day
+window, packed as CSR into w; the same farm can not be source and destination.
+Row r writes its pairs from r * keep on, only one row of costs exists per thread*/
+static void keep_cheapest_pairs(struct assign_workspace *w, const int *rows, int n, int m, int keep,
+                                struct move_table *Moves, int *day_selected_dis, uint16_t **dis_matrix, const struct match_options *opts)
+{
+  long int num_edges = 0;
+  int r;
+
+  reserve_assign_workspace(w, n, m, (long int)n * keep);
+#pragma omp parallel
+  {
+     int32_t *row_cost = (int32_t*)malloc(sizeof(int32_t) * m);
+     int *select_buf = (int*)malloc(sizeof(int) * m);
+     int rr, cc, des, sel, row_day, num_valid, threshold, ties;
+     int32_t cost;
+     long int k;
+     struct stub_node *node;
+
+#pragma omp for schedule(dynamic, 16)
+     for (rr = 0; rr < n; rr++)
+        {
+           des = Moves->des_farm[rows[rr]];
+           sel = day_selected_dis[rows[rr]];
+           row_day = Moves->day[rows[rr]];
+           num_valid = 0;
+           for (cc = 0; cc < m; cc++)
+              {
+                 node = w->col_node[cc];
+                 if (node -> farm_id == des || w->col_day[cc] < row_day - opts->error_range_day_movement || w->col_day[cc] > row_day + opts->days_after)
+                    {
+                       cost = ASSIGN_FORBIDDEN;
+                    }
+                 else
+                    {
+                       cost = abs(sel - dis_matrix[node -> farm_id][des]);
+                       select_buf[num_valid++] = cost;
+                    }
+                 row_cost[cc] = cost;
+              }
+
+           /* KEEP THE PAIRS BELOW THE keep-TH COST, THEN AS MANY AT THAT COST AS FIT*/
+           threshold = ASSIGN_FORBIDDEN - 1;
+           ties = keep;
+           if (num_valid > keep)
+              {
+                 threshold = kth_smallest(select_buf, num_valid, keep - 1);
+                 ties = 0;
+                 for (cc = 0; cc < keep; cc++)
+                    {
+                       if (select_buf[cc] == threshold) ties++;
+                    }
+              }
+           k = (long int)rr * keep;
+           for (cc = 0; cc < m; cc++)
+              {
+                 cost = row_cost[cc];
+                 if (cost < threshold || (cost == threshold && ties-- > 0))
+                    {
+                       w->edge_col[k] = cc;
+                       w->edge_cost[k] = cost;
+                       k++;
+                    }
+              }
+           w->row_edges[rr] = k - (long int)rr * keep;
+           w->row_valid[rr] = num_valid;
+        }
+     free(row_cost);
+     free(select_buf);
+  }
+
+  /* PACK THE PAIRS INTO CSR (rows only move down)*/
+  for (r = 0; r < n; r++)
+     {
+        w->row_start[r] = num_edges;
+        memmove(w->edge_col + num_edges, w->edge_col + (long int)r * keep, sizeof(int) * w->row_edges[r]);
+        memmove(w->edge_cost + num_edges, w->edge_cost + (long int)r * keep, sizeof(int32_t) * w->row_edges[r]);
+        num_edges = num_edges + w->row_edges[r];
+     }
+  w->row_start[n] = num_edges;
+}
+
+/* Solve one block: rows[] are indices into Moves sharing the bucket keys[], the rows of
+the day being rewired (index < num_day_moves) first, then the later days in day order*/
+static void assign_block(struct assign_workspace *w, const int *rows, int n, long int num_day_moves, const uint32_t *keys, int num_keys,
+                         struct move_table *Moves, int *day_selected_dis, struct day_buckets *outstubs_day,
+                         uint16_t **dis_matrix, const struct match_options *opts,
+                         struct stub_node **day_best_node, struct stub_bucket **day_best_bucket, int *day_best_day)
+{
+  int m = 0, r, c, i, search_day, keep, cut, lost;
+  int first_day = Moves->day[rows[0]];
+  int last_day = Moves->day[rows[n-1]];
+
+  /* COLLECT THE INWARD STUBS STILL FREE IN THE WINDOWS OF THE BLOCK: the window of first_day
+     in search order, then the days after it that only the later rows reach*/
+  for (i = 0; i < opts->num_day_offsets; i++)
+     {
+        m = add_block_columns(w, n, m, first_day + opts->day_offsets[i], keys, num_keys, outstubs_day, opts);
+     }
+  for (search_day = first_day + opts->days_after + 1; search_day <= last_day + opts->days_after; search_day++)
+     {
+        m = add_block_columns(w, n, m, search_day, keys, num_keys, outstubs_day, opts);
+     }
+  if (m == 0)
+     {
+        return;
+     }
+  w->unmatched_cost = opts->assign_unmatched_cost;
+  keep = (opts->assign_candidates > 0 && opts->assign_candidates < m) ? opts->assign_candidates : m;
+  keep_cheapest_pairs(w, rows, n, m, keep, Moves, day_selected_dis, dis_matrix, opts);
+  solve_assignment(w, n, m);
+
+  /* CUTTING PAIRS MUST NOT COST A MATCH: while some pairs were cut and a destination that had
+     pairs is left unmatched, the cut pairs may be the way to match it; solve again with twice as many*/
+  while (keep < m)
+     {
+        cut = 0;
+        lost = 0;
+        for (r = 0; r < n; r++)
+           {
+              if (w->row_valid[r] > keep) cut = 1;
+              if (w->row_col[r] >= m && w->row_valid[r] > 0) lost = 1;
+           }
+        if (cut == 0 || lost == 0)
+           {
+              break;
+           }
+        keep = (keep < m / 2) ? keep * 2 : m;
+        keep_cheapest_pairs(w, rows, n, m, keep, Moves, day_selected_dis, dis_matrix, opts);
+        solve_assignment(w, n, m);
+     }
+
+  for (r = 0; r < n && rows[r] < num_day_moves; r++)
+     {
+        c = w->row_col[r];
+        if (c < m)
+           {
+              day_best_node[rows[r]] = w->col_node[c];
+              day_best_bucket[rows[r]] = w->col_bucket[c];
+              day_best_day[rows[r]] = w->col_day[c];
+              w->col_node[c] -> taken = 1;
+           }
+     }
+}
+
+/* Rows are sorted by block key (batch type in the top byte), then by position in Moves*/
+struct assign_row {
+      uint64_t key;
+      int row;
+   };
+static int comp_assign_row(const void *a, const void *b)
+{
+  const struct assign_row *p1 = (const struct assign_row*)a;
+  const struct assign_row *p2 = (const struct assign_row*)b;
+  if (p1->key < p2->key) return -1;
+  if (p1->key > p2->key) return 1;
+  return 0;
+}
+
+/* Rows order[first .. last) of equal batch type and island*/
+struct assign_segment {
+      long int first, last;
+   };
+static int comp_assign_segment(const void *a, const void *b)
+{
+  const struct assign_segment *p1 = (const struct assign_segment*)a;
+  const struct assign_segment *p2 = (const struct assign_segment*)b;
+  if (p1->last - p1->first > p2->last - p2->first) return -1;
+  if (p1->last - p1->first < p2->last - p2->first) return 1;
+  if (p1->first < p2->first) return -1;
+  if (p1->first > p2->first) return 1;
+  return 0;
+}
+
+/* assign_day: FILL day_best_node/bucket/day FOR THE num_day_moves MOVEMENTS OF THE DAY BEING REWIRED
+(NULL when unmatched). Moves holds them first, then the num_rows - num_day_moves movements of
+the pending days after it. Stubs given away are flagged taken; step 3.5 deletes them.*/
+static void assign_day(struct move_table *Moves, long int num_rows, long int num_day_moves, int *day_selected_dis, struct day_buckets *outstubs_day,
+                    struct farm_table *FarmData, uint16_t **dis_matrix, const struct match_options *opts,
+                    struct stub_node **day_best_node, struct stub_bucket **day_best_bucket, int *day_best_day)
+{
+  struct assign_row *order = (struct assign_row*)malloc(sizeof(struct assign_row) * num_rows);
+  struct assign_segment *segments = (struct assign_segment*)malloc(sizeof(struct assign_segment) * num_rows);
+  long int k, first, last;
+  int num_segments = 0, des;
+
+  for (k = 0; k < num_rows; k++)
+     {
+        des = Moves->des_farm[k];
+        order[k].key = ((uint64_t)stub_key(Moves->batch_type[k],
+                                           (opts->strat_island == 1) ? FarmData->island[des] : STUB_KEY_ANY,
+                                           (opts->strat_dca == 1) ? dca_code(FarmData->testarea[des]) : STUB_KEY_ANY) << 32) | (uint32_t)k;
+        order[k].row = (int)k;
+        day_best_node[k] = NULL;
+        day_best_bucket[k] = NULL;
+        day_best_day[k] = -1;
+     }
+  qsort(order, num_rows, sizeof(order[0]), comp_assign_row);
+
+  /* SEGMENTS OF EQUAL BATCH TYPE AND ISLAND (the key without its DCA byte) TAKE STUBS FROM
+     DISJOINT BUCKETS, so they are solved in parallel, the largest first*/
+  for (first = 0; first < num_rows; first = last)
+     {
+        last = first;
+        while (last < num_rows && (order[last].key >> 40) == (order[first].key >> 40))
+           {
+              last++;
+           }
+        segments[num_segments].first = first;
+        segments[num_segments].last = last;
+        num_segments++;
+     }
+  qsort(segments, num_segments, sizeof(segments[0]), comp_assign_segment);
+
+#pragma omp parallel if (num_segments > 1)
+  {
+     struct assign_workspace w;
+     int *rows = (int*)malloc(sizeof(int) * num_rows);
+     uint32_t keys[NUM_DCA_CODES];
+     long int seg_first, seg_last;
+     int s, n, num_keys, row0, row_des;
+
+     memset(&w, 0, sizeof(w));
+#pragma omp for schedule(dynamic, 1)
+     for (s = 0; s < num_segments; s++)
+        {
+           /* BLOCKS OF EQUAL KEY (one per destination DCA) MAY SHARE BUCKETS AND ARE SOLVED IN ORDER;
+              a block without a movement of the day being rewired has nothing to keep*/
+           for (seg_first = segments[s].first; seg_first < segments[s].last; seg_first = seg_last)
+              {
+                 seg_last = seg_first;
+                 n = 0;
+                 while (seg_last < segments[s].last && (order[seg_last].key >> 32) == (order[seg_first].key >> 32))
+                    {
+                       rows[n] = order[seg_last].row;
+                       n++;
+                       seg_last++;
+                    }
+                 row0 = rows[0];
+                 if (row0 >= num_day_moves)
+                    {
+                       continue;
+                    }
+                 row_des = Moves->des_farm[row0];
+                 num_keys = destination_stub_keys(Moves->batch_type[row0], FarmData->island[row_des], FarmData->testarea[row_des],
+                                                  opts->strat_island, opts->strat_dca, (int (*)[NUM_DCA_CODES])opts->allowed_dca, keys);
+                 assign_block(&w, rows, n, num_day_moves, keys, num_keys, Moves, day_selected_dis, outstubs_day,
+                              dis_matrix, opts, day_best_node, day_best_bucket, day_best_day);
+              }
+        }
+     free(rows);
+     free_assign_workspace(&w);
+  }
+  free(segments);
+  free(order);
+}
+/* -------------------------------------------------------------------------- */
+
+/*-----------------------------------------------------------------------------*/
+/* Read the allowed source (rows) x destination (columns) DCA combinations.
+Row and column 5 stand for an unknown DCA status.
+/* -------------------------------------------------------------------------- */
+void rewire_read_allowed_dca(char AllowedDCAFile[], int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES])
+{
+    FILE *Allowed = fopen(AllowedDCAFile,"r");
+    int line_num, col_num;
+
+    for(line_num = 0; line_num < NUM_DCA_CODES; line_num++)
+      {
+       for(col_num = 0; col_num < NUM_DCA_CODES; col_num++)
+       {
+         fscanf(Allowed, "%d,", &allowed_dca[line_num][col_num]);
+       }
+      }
+   fclose(Allowed);
+}
+/*-----------------------------------------------------------------------------*/
+
+/* -------------------------------------------------------------------------- */
+/* PENDING DAYS: MOVEMENTS LOADED BUT NOT REWIRED YET */
+/* -------------------------------------------------------------------------- */
+/* Earliest pending day in the window, -1 if none*/
+static int first_pending_day(struct day_buckets *outstubs_day, int day_window)
+{
+  int i, first = -1;
+  for (i = 0; i < day_window; i++)
+     {
+        if (outstubs_day[i].pending == 1 && (first == -1 || outstubs_day[i].day < first))
+           {
+              first = outstubs_day[i].day;
+           }
+     }
+  return (first);
+}
+
+/* Copy the movements of From to To[first ..], growing To (capacity rows) as needed*/
+static void copy_moves(struct move_table *To, long int *capacity, long int first, const struct move_table *From)
+{
+  long int n = From->num_moves;
+  if (first + n > *capacity)
+     {
+        *capacity = first + n;
+        To->src_farm = (int32_t*)realloc(To->src_farm, sizeof(int32_t) * *capacity);
+        To->des_farm = (int32_t*)realloc(To->des_farm, sizeof(int32_t) * *capacity);
+        To->move_id = (int32_t*)realloc(To->move_id, sizeof(int32_t) * *capacity);
+        To->day = (uint16_t*)realloc(To->day, sizeof(uint16_t) * *capacity);
+        To->batch_type = (uint8_t*)realloc(To->batch_type, sizeof(uint8_t) * *capacity);
+        To->selected_dis = (uint16_t*)realloc(To->selected_dis, sizeof(uint16_t) * *capacity);
+     }
+  memcpy(To->src_farm + first, From->src_farm, sizeof(int32_t) * n);
+  memcpy(To->des_farm + first, From->des_farm, sizeof(int32_t) * n);
+  memcpy(To->move_id + first, From->move_id, sizeof(int32_t) * n);
+  memcpy(To->day + first, From->day, sizeof(uint16_t) * n);
+  memcpy(To->batch_type + first, From->batch_type, sizeof(uint8_t) * n);
+  memcpy(To->selected_dis + first, From->selected_dis, sizeof(uint16_t) * n);
+  To->num_moves = first + n;
+}
+
+/* Copy the movements of the day just read into its slot and mark it pending*/
+static void keep_day_moves(struct day_buckets *day_slot, struct move_table *DayMoves)
+{
+  copy_moves(&day_slot->moves, &day_slot->moves_capacity, 0, DayMoves);
+  day_slot->pending = 1;
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* ORDER THE IN-MEMORY MOVEMENTS BY DAY, RANDOMLY WITHIN A DAY */
+/* -------------------------------------------------------------------------- */
+static void order_moves_by_day(struct move_table *MoveData, struct move_sort_key *move_order, long int num_moves)
+{
+  long int i;
+  int randInt;
+
+  /* Attach a random number to each batch for random sorting*/
+  for (i = 0; i < num_moves; i++)
+     {
+        randInt = (int)rand_interval(0,(unsigned int)(num_moves));
+        move_order[i].key = ((uint64_t)MoveData->day[i] << 32) | (uint32_t)randInt;
+        move_order[i].move = (int32_t)i;
+     }
+  qsort(move_order, num_moves, sizeof(move_order[0]), comp_random);
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* START READING THE MOVEMENTS FROM THE FIRST DAY AGAIN, WITH THE PREDICTIONS OF count_iter */
+/* -------------------------------------------------------------------------- */
+static void rewind_move_stream(struct move_stream *stream, long int count_iter)
+{
+  stream->cursor = 0;
+  stream->has_pending = 0;
+  stream->last_day = -1;
+  if (stream->file != NULL)
+     {
+        rewind(stream->file);
+     }
+  if (stream->pred_file != NULL)
+     {
+        fseek(stream->pred_file, (long int)(sizeof(PREDICTION_MAGIC) + 2 * sizeof(int64_t)) + count_iter * stream->pred_rows * (long int)sizeof(uint16_t), SEEK_SET);
+        stream->pred_read = 0;
+     }
+}
+/* -------------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* GROW THE DAY BUFFER SO IT HOLDS AT LEAST n MOVEMENTS */
+/* -------------------------------------------------------------------------- */
+static void reserve_day_moves(struct move_stream *stream, struct move_table *DayMoves, long int n)
+{
+  if (n <= stream->capacity)
+     {
+        return;
+     }
+  stream->capacity = (stream->capacity == 0) ? 256 : stream->capacity;
+  while (stream->capacity < n)
+     {
+        stream->capacity = stream->capacity * 2;
+     }
+  DayMoves->src_farm = (int32_t*)realloc(DayMoves->src_farm, sizeof(int32_t) * stream->capacity);
+  DayMoves->des_farm = (int32_t*)realloc(DayMoves->des_farm, sizeof(int32_t) * stream->capacity);
+  DayMoves->move_id = (int32_t*)realloc(DayMoves->move_id, sizeof(int32_t) * stream->capacity);
+  DayMoves->day = (uint16_t*)realloc(DayMoves->day, sizeof(uint16_t) * stream->capacity);
+  DayMoves->batch_type = (uint8_t*)realloc(DayMoves->batch_type, sizeof(uint8_t) * stream->capacity);
+  DayMoves->selected_dis = (uint16_t*)realloc(DayMoves->selected_dis, sizeof(uint16_t) * stream->capacity);
+}
+
+/* -------------------------------------------------------------------------- */
+/* next_day_moves: COPY ALL MOVEMENTS OF THE NEXT DAY INTO DayMoves.
+Movements read from file are shuffled within the day, in-memory movements are
+already in random order (order_moves_by_day). With a prediction file, the
+prediction of each line is read with it. Returns 0 when no day is left,
+-1 if the file goes back in days or has not one prediction per line. */
+/* -------------------------------------------------------------------------- */
+static long int next_day_moves(struct move_stream *stream, struct move_table *DayMoves)
+{
+  long int n = 0;
+  long int k, r;
+  int day;
+  int32_t tmp32;
+  uint16_t tmp16, pred = 0;
+  uint8_t tmp8;
+
+  if (stream->file == NULL)
+     {
+        /* IN MEMORY: TAKE THE RUN OF MOVEMENTS WITH THE SAME DAY */
+        struct move_table *MoveData = stream->MoveData;
+        long int move;
+        if (stream->cursor >= MoveData->num_moves)
+           {
+              return (0);
+           }
+        day = MoveData->day[stream->move_order[stream->cursor].move];
+        while (stream->cursor < MoveData->num_moves)
+           {
+              move = stream->move_order[stream->cursor].move;
+              if (MoveData->day[move] != day)
+                 {
+                    break;
+                 }
+              reserve_day_moves(stream, DayMoves, n + 1);
+              DayMoves->src_farm[n] = MoveData->src_farm[move];
+              DayMoves->des_farm[n] = MoveData->des_farm[move];
+              DayMoves->move_id[n] = MoveData->move_id[move];
+              DayMoves->day[n] = MoveData->day[move];
+              DayMoves->batch_type[n] = MoveData->batch_type[move];
+              n++;
+              stream->cursor++;
+           }
+        DayMoves->num_moves = n;
+        return (n);
+     }
+
+  /* STREAMING: READ LINES UNTIL THE DAY CHANGES, KEEP THAT LINE FOR THE NEXT CALL */
+  double src_farm, des_farm, day_read, batch_cat, move_id;
+  if (stream->has_pending == 1)
+     {
+        reserve_day_moves(stream, DayMoves, 1);
+        DayMoves->src_farm[0] = stream->pending_src;
+        DayMoves->des_farm[0] = stream->pending_des;
+        DayMoves->move_id[0] = stream->pending_move_id;
+        DayMoves->day[0] = (uint16_t)stream->pending_day;
+        DayMoves->batch_type[0] = (uint8_t)stream->pending_batch;
+        DayMoves->selected_dis[0] = stream->pending_pred;
+        stream->has_pending = 0;
+        n = 1;
+     }
+  while (fscanf(stream->file, "%lf,%lf,%lf,%lf,%lf", &src_farm, &des_farm, &day_read, &batch_cat, &move_id) == 5)
+     {
+        day = (int)day_read;
+        if (day < stream->last_day)
+           {
+              return (-1);
+           }
+        if (stream->pred_file != NULL)
+           {
+              if (stream->pred_read == stream->pred_rows || fread(&pred, sizeof(uint16_t), 1, stream->pred_file) != 1)
+                 {
+                    return (-1); // more lines than predictions
+                 }
+              stream->pred_read++;
+           }
+        if (n > 0 && day != DayMoves->day[0])
+           {
+              stream->pending_src = (int32_t)src_farm;
+              stream->pending_des = (int32_t)des_farm;
+              stream->pending_move_id = (int32_t)move_id;
+              stream->pending_day = day;
+              stream->pending_batch = (int)batch_cat;
+              stream->pending_pred = pred;
+              stream->has_pending = 1;
+              stream->last_day = day;
+              break;
+           }
+        reserve_day_moves(stream, DayMoves, n + 1);
+        DayMoves->src_farm[n] = (int32_t)src_farm;
+        DayMoves->des_farm[n] = (int32_t)des_farm;
+        DayMoves->move_id[n] = (int32_t)move_id;
+        DayMoves->day[n] = (uint16_t)day;
+        DayMoves->batch_type[n] = (uint8_t)batch_cat;
+        DayMoves->selected_dis[n] = pred;
+        stream->last_day = day;
+        n++;
+     }
+  if (stream->has_pending == 0 && stream->pred_file != NULL && stream->pred_read != stream->pred_rows)
+     {
+        return (-1); // fewer lines than predictions
+     }
+
+  /* SHUFFLE THE DAY (Fisher-Yates) SO STUBS ARE VISITED IN RANDOM ORDER*/
+  for (k = n - 1; k > 0; k--)
+     {
+        r = (long int)rand_interval(0, (unsigned int)k);
+        tmp32 = DayMoves->src_farm[k]; DayMoves->src_farm[k] = DayMoves->src_farm[r]; DayMoves->src_farm[r] = tmp32;
+        tmp32 = DayMoves->des_farm[k]; DayMoves->des_farm[k] = DayMoves->des_farm[r]; DayMoves->des_farm[r] = tmp32;
+        tmp32 = DayMoves->move_id[k]; DayMoves->move_id[k] = DayMoves->move_id[r]; DayMoves->move_id[r] = tmp32;
+        tmp8 = DayMoves->batch_type[k]; DayMoves->batch_type[k] = DayMoves->batch_type[r]; DayMoves->batch_type[r] = tmp8;
+        tmp16 = DayMoves->selected_dis[k]; DayMoves->selected_dis[k] = DayMoves->selected_dis[r]; DayMoves->selected_dis[r] = tmp16;
+     }
+  DayMoves->num_moves = n;
+  return (n);
+}
+/* -------------------------------------------------------------------------- */
+
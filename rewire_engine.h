@@ -0,0 +1,137 @@
+/*------------------------------------------------------------------------------*/
+/* Rewiring engine used to re-wire New Zealand dairy cattle movement.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+C API of the rewiring engine. The caller owns the farm, movement and predicted
+distance arrays and the histogram buffers; the engine only keeps pointers to
+them and never copies them. Every matched movement and every stub left
+unmatched can be handed back through callbacks.
+
+Typical use (see Network_rewire_C_code_random_sc.c for the file based driver):
+  1 rewire_default_config, then change the settings.
+  2 rewire_create with the farm table, optionally rewire_load_road_distances,
+    then rewire_build_distances.
+  3 rewire_set_moves (in memory) or rewire_set_move_file (streamed, sorted by day).
+  4 rewire_set_predictions, or rewire_set_prediction_file after rewire_set_move_file,
+    rewire_set_histograms, optionally rewire_set_callbacks.
+  5 rewire_observed once, then rewire_run_iteration for every iteration. Set the
+    callbacks before rewire_observed to also receive the observed movements.
+  6 rewire_destroy.
+The engine draws random numbers with rand(); seed it with srand() beforehand.
+Build with -fopenmp to solve the assignment engine's batch type segments in parallel. */
+/*------------------------------------------------------------------------------*/
+#ifndef REWIRE_ENGINE_H
+#define REWIRE_ENGINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define NUM_DCA_CODES 6 // DCA status 0-4 and unknown (99) as 5
+#define NUM_DCA_COMBINATIONS 26 // 25 combinations 5*5 and column[25] for batch that includes at least one unknown testarea
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */
+
+  /* Farm and movement data are held as typed columns (struct of arrays) so the
+     hot loop reads ids, days and categories directly without double->int casts. */
+  struct farm_table {
+      long int num_farms;
+      double *x_coord;
+      double *y_coord;
+      int32_t *farm_id;
+      uint8_t *testarea; // 0-4 DCA status, 99 unknown
+      uint8_t *island;
+   };
+
+  struct move_table {
+      long int num_moves;
+      int32_t *src_farm;
+      int32_t *des_farm;
+      int32_t *move_id; // row in the predicted distances
+      uint16_t *day;
+      uint8_t *batch_type;
+      uint16_t *selected_dis; // predicted distance in the iteration being run, filled by the engine when predictions are streamed (callers leave it NULL)
+   };
+
+  /* Settings of the rewiring, filled with defaults by rewire_default_config*/
+  struct rewire_config {
+      int num_simu; // number of iterations
+      int error_range_day_movement; // Erro Range of days that will be allowed for inward stubs.
+      int symmetric_window; // 1: inward stubs may also come from the error_range_day_movement days after the movement (+/- window)
+      int prune_buckets; // 1: skip buckets whose bounding box shows they can not beat the best inward stub found so far
+      int strat_island; // 1: inward stub must come from a farm on the same island as the destination
+      int strat_dca; // 1: only source/destination DCA combinations allowed in allowed_dca are matched
+      int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES]; // rows source DCA 0-4 and unknown, columns destination DCA
+      int match_engine; // 0: greedy, each outward stub takes its best inward stub in random order. 1: min-cost assignment of each (batch type, stratum) block of the days whose windows overlap, kept one day at a time
+      int assign_candidates; // engine 1: number of cheapest inward stubs kept per destination before solving (0 keeps all)
+      int assign_unmatched_cost; // engine 1: km of |selected_dis - distance| an outward stub left unmatched counts as (0: never leave one that can be matched)
+   };
+
+  /* Caller buffers the histograms are counted into. Column 0 / row 0 is the observed data,
+     column / row count_iter+1 is iteration count_iter. */
+  struct rewire_histograms {
+      int32_t *dis_all;    // rewire_hist_rows x (num_simu+1), row-major: counts of movements by distance (km)
+      int32_t *dis_calf;   // same, batch type 0
+      int32_t *dis_heifer; // same, batch type 1
+      int32_t *dis_adult;  // same, batch type 2
+      int32_t *dca;        // (num_simu+1) x NUM_DCA_COMBINATIONS: counts by source*5 + destination DCA
+   };
+
+  /* One rewired movement*/
+  struct rewire_match {
+      long int count_iter; // -1 for the observed movements passed on by rewire_observed
+      int src_farm;
+      int des_farm;
+      int day;        // day of the movement
+      int src_day;    // day of the inward stub it was matched to
+      int batch_type;
+      int distance;   // km
+   };
+
+  /* Summary of one iteration*/
+  struct rewire_iteration_stats {
+      long int count_iter;
+      long int matched;
+      long int unmatched;      // stubs retired without a partner
+      long int cost;           // total |selected_dis - distance| of the matched movements
+      long int skipped;        // buckets skipped by the bounding box bound
+   };
+
+  typedef void (*rewire_match_fn)(const struct rewire_match *match, void *user);
+  typedef void (*rewire_unmatched_fn)(long int count_iter, int day, int farm_id, int batch_type, void *user);
+
+  struct rewire_engine; // opaque
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+void rewire_default_config(struct rewire_config *config);
+struct rewire_engine *rewire_create(const struct rewire_config *config, const struct farm_table *FarmData);
+long int rewire_load_road_distances(struct rewire_engine *engine, char RoadDistanceFile[]); // returns the number of road pairs, -1 on error
+int rewire_build_distances(struct rewire_engine *engine); // returns max_dis
+int rewire_road_slack(const struct rewire_engine *engine);
+int rewire_road_distance(const struct rewire_engine *engine, int src_farm, int des_farm); // -1 if the pair has no road distance
+int rewire_max_dis(const struct rewire_engine *engine);
+long int rewire_hist_rows(const struct rewire_engine *engine); // rows of the distance histograms: max_dis + 1
+int rewire_distance(const struct rewire_engine *engine, int src_farm, int des_farm);
+void rewire_set_moves(struct rewire_engine *engine, const struct move_table *MoveData);
+void rewire_set_move_file(struct rewire_engine *engine, FILE *MoveFile);
+void rewire_set_predictions(struct rewire_engine *engine, const uint16_t *CovPredData, long int num_covs, long int stride);
+int rewire_set_prediction_file(struct rewire_engine *engine, FILE *PredFile); // streamed movements only: returns 0, -1 if the file can not be used
+void rewire_set_histograms(struct rewire_engine *engine, struct rewire_histograms *hist); // all NULL: count nothing
+void rewire_set_match_engine(struct rewire_engine *engine, int match_engine);
+void rewire_set_callbacks(struct rewire_engine *engine, rewire_match_fn on_match, rewire_unmatched_fn on_unmatched, void *user);
+/* Both return 0, -1 if the movement file is not sorted by day or its lines do not match the prediction file*/
+int rewire_observed(struct rewire_engine *engine);
+int rewire_run_iteration(struct rewire_engine *engine, long int count_iter, struct rewire_iteration_stats *stats);
+void rewire_destroy(struct rewire_engine *engine);
+
+/* CSV loaders used by the driver*/
+void rewire_read_farm_data(char FarmDataFile[], struct farm_table *FarmData, long int num_farms);
+void rewire_read_movement_data(char MoveDataFile[], struct move_table *MoveData, long int num_moves);
+void rewire_read_distance_intervals(char DistanceIntervalFile[], uint16_t *CovPredData, int num_covs, int num_simu);
+void rewire_read_allowed_dca(char AllowedDCAFile[], int allowed_dca[NUM_DCA_CODES][NUM_DCA_CODES]);
+
+double rewire_calc_dis(double src_x, double src_y, double des_x, double des_y);
+
+#endif
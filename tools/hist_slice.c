@@ -0,0 +1,101 @@
+/*------------------------------------------------------------------------------*/
+/* Cut iterations and bins out of a histogram file written by the driver.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Only the columns of the selected iterations are read, found through the
+column directory, and each is decoded up to last_bin only. Iteration -1 is
+the observed network. The slice is written as CSV in the layout of the file
+(see tools/hist_to_csv.c), networks in iteration order.
+
+Build: gcc -O2 -I. -o hist_slice tools/hist_slice.c histogram_file.c
+Usage: hist_slice FreqDisFile.rwh first_iter last_iter first_bin last_bin [slice.csv] */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "histogram_file.h"
+
+
+/* ########################################################################## */
+/* MAIN PROGRAM */
+int main(int argc, char *argv[])
+{
+  struct hist_file hist;
+  int32_t *table;
+  long int first_iter, last_iter, first_bin, last_bin, num_bins, num_networks, iter, network, n;
+  FILE *Csv;
+
+  if (argc < 6)
+     {
+        fprintf(stderr, "Usage: %s FreqDisFile.rwh first_iter last_iter first_bin last_bin [slice.csv]\n", argv[0]);
+        return (1);
+     }
+  first_iter = atol(argv[2]);
+  last_iter = atol(argv[3]);
+  first_bin = atol(argv[4]);
+  last_bin = atol(argv[5]);
+  if (hist_open(argv[1], &hist) != 0)
+     {
+        fprintf(stderr, "Can not read %s\n", argv[1]);
+        return (1);
+     }
+
+/* 1. CHECK THE RANGES; bins past the end are cut off*/
+  if (last_bin >= hist.meta.num_bins)
+     {
+        last_bin = (long int)hist.meta.num_bins - 1;
+     }
+  if (first_bin < 0 || first_bin > last_bin || first_iter > last_iter)
+     {
+        fprintf(stderr, "Empty bin or iteration range\n");
+        return (1);
+     }
+  for (iter = first_iter; iter <= last_iter; iter++)
+     {
+        if (hist_network_of_iter(&hist.meta, iter) < 0)
+           {
+              fprintf(stderr, "Iteration %ld is not in %s (iterations %d-%d%s)\n", iter, argv[1], hist.meta.first_iter, hist.meta.last_iter,
+                      (hist.meta.has_observed == 1) ? " and observed -1" : "");
+              return (1);
+           }
+     }
+
+/* 2. READ THE SELECTED COLUMNS, slice network n at table[n * num_bins]*/
+  num_bins = last_bin - first_bin + 1;
+  num_networks = last_iter - first_iter + 1;
+  table = (int32_t*)malloc(sizeof(int32_t) * num_bins * num_networks);
+  for (n = 0; n < num_networks; n++)
+     {
+        network = hist_network_of_iter(&hist.meta, first_iter + n);
+        if (hist_read_column(&hist, network, first_bin, last_bin, table + n * num_bins) != 0)
+           {
+              fprintf(stderr, "Corrupt column %ld in %s\n", network, argv[1]);
+              return (1);
+           }
+     }
+
+/* 3. WRITE THE SLICE*/
+  Csv = (argc > 6) ? fopen(argv[6], "w") : stdout;
+  if (Csv == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[6]);
+        return (1);
+     }
+  if (hist_write_csv(Csv, hist.meta.layout, table, num_bins, num_networks) != 0 || (Csv != stdout && fclose(Csv) != 0))
+     {
+        fprintf(stderr, "Can not write %s\n", (argc > 6) ? argv[6] : "the slice");
+        return (1);
+     }
+
+  free(table);
+  hist_close(&hist);
+  return (0);
+}
+/* END OF MAIN PROGRAM*/
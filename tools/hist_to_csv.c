@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------*/
+/* Convert a histogram file written by the driver back into its CSV output.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+The CSV is the one the driver writes with hist_format 0: FreqDisFile layout
+(one row per bin, "%d," per network) or DCAfreqDataFile layout (one row per
+network, "%d," per bin), as recorded in the file. With "info" only the
+metadata is printed.
+
+Build: gcc -O2 -I. -o hist_to_csv tools/hist_to_csv.c histogram_file.c
+Usage: hist_to_csv FreqDisFile.rwh [FreqDisFile.csv | info] */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "histogram_file.h"
+
+
+/* ########################################################################## */
+/* MAIN PROGRAM */
+int main(int argc, char *argv[])
+{
+  struct hist_file hist;
+  struct hist_meta *meta = &hist.meta;
+  int32_t *table;
+  long int num_bins, num_networks, n;
+  FILE *Csv;
+
+  if (argc < 2)
+     {
+        fprintf(stderr, "Usage: %s FreqDisFile.rwh [FreqDisFile.csv | info]\n", argv[0]);
+        return (1);
+     }
+  if (hist_open(argv[1], &hist) != 0)
+     {
+        fprintf(stderr, "Can not read %s\n", argv[1]);
+        return (1);
+     }
+
+/* 1. METADATA ONLY*/
+  if (argc > 2 && strcmp(argv[2], "info") == 0)
+     {
+        printf("scenario %s\nquantity %s\nseed %llu\nbatch_type %d\n", meta->scenario, meta->quantity, (unsigned long long)meta->seed, meta->batch_type);
+        printf("bins %lld\nnetworks %lld\nobserved %d\niterations %d-%d\nlayout %s\n", (long long)meta->num_bins, (long long)meta->num_networks,
+               meta->has_observed, meta->first_iter, meta->last_iter, (meta->layout == HIST_LAYOUT_BIN_ROWS) ? "bin_rows" : "network_rows");
+        hist_close(&hist);
+        return (0);
+     }
+
+/* 2. DECODE ALL COLUMNS, network n at table[n * num_bins]*/
+  num_bins = (long int)meta->num_bins;
+  num_networks = (long int)meta->num_networks;
+  table = (int32_t*)malloc(sizeof(int32_t) * (num_bins * num_networks + 1));
+  for (n = 0; n < num_networks && num_bins > 0; n++)
+     {
+        if (hist_read_column(&hist, n, 0, num_bins - 1, table + n * num_bins) != 0)
+           {
+              fprintf(stderr, "Corrupt column %ld in %s\n", n, argv[1]);
+              return (1);
+           }
+     }
+
+/* 3. WRITE THE CSV AS THE DRIVER DOES*/
+  Csv = (argc > 2) ? fopen(argv[2], "w") : stdout;
+  if (Csv == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[2]);
+        return (1);
+     }
+  if (hist_write_csv(Csv, meta->layout, table, num_bins, num_networks) != 0 || (Csv != stdout && fclose(Csv) != 0))
+     {
+        fprintf(stderr, "Can not write %s\n", (argc > 2) ? argv[2] : "the CSV");
+        return (1);
+     }
+
+  free(table);
+  hist_close(&hist);
+  return (0);
+}
+/* END OF MAIN PROGRAM*/
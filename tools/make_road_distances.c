@@ -0,0 +1,196 @@
+/*------------------------------------------------------------------------------*/
+/* Convert a CSV file of road distances into the binary file read by
+rewire_load_road_distances.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Input lines: source farm, destination farm, km (farm ids are the rows of
+FarmDataFile, as in the movement data), in any order, after an optional header
+line. Any other line that does not parse stops the conversion. A pair listed twice
+keeps its shortest distance. With "symmetric" every pair is also stored in
+the other direction, unless that direction is listed itself.
+
+Output (little-endian), CSR by source farm:
+  char magic[8] = "RWDIST1"; int64_t num_farms; int64_t num_entries;
+  uint64_t row_start[num_farms + 1];
+  int32_t des_farm[num_entries]; // ascending within each row
+  uint16_t km[num_entries];
+
+Build: gcc -O2 -o make_road_distances tools/make_road_distances.c
+Usage: make_road_distances RoadDistance.csv num_farms RoadDistanceFile.bin [symmetric] */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ROAD_DISTANCE_MAGIC "RWDIST1"
+
+/* STRUCTURE DECLARATIONS----------------------------------------------------- */
+  struct road_pair {
+      int32_t src_farm;
+      int32_t des_farm;
+      int32_t km;
+      int32_t listed; // 1: read from the CSV, 0: mirrored from the other direction
+   };
+
+/* ########################################################################## */
+/* FUNCTION DEFINITIONS */
+
+int comp_road_pair(const void *a, const void *b);
+
+
+/* ########################################################################## */
+/* MAIN PROGRAM */
+int main(int argc, char *argv[])
+{
+  long int num_farms, num_pairs = 0, capacity = 1024, num_entries, i, k, line_num = 0;
+  int symmetric, src_farm, des_farm, ok;
+  double km;
+  char line[256];
+  struct road_pair *pairs;
+  FILE *Csv, *Out;
+
+  if (argc < 4)
+     {
+        fprintf(stderr, "Usage: %s RoadDistance.csv num_farms RoadDistanceFile.bin [symmetric]\n", argv[0]);
+        return (1);
+     }
+  num_farms = atol(argv[2]);
+  symmetric = (argc > 4 && strcmp(argv[4], "symmetric") == 0) ? 1 : 0;
+
+/* 1. READ THE PAIRS*/
+  Csv = fopen(argv[1], "r");
+  if (Csv == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[1]);
+        return (1);
+     }
+  pairs = (struct road_pair*)malloc(sizeof(struct road_pair) * capacity);
+  while (fgets(line, sizeof(line), Csv) != NULL)
+     {
+        line_num++;
+        if (strspn(line, " \t\r\n") == strlen(line))
+           {
+              continue; // blank line
+           }
+        if (sscanf(line, "%d,%d,%lf", &src_farm, &des_farm, &km) != 3)
+           {
+              if (line_num == 1)
+                 {
+                    continue; // header
+                 }
+              fprintf(stderr, "Can not parse line %ld of %s: %s", line_num, argv[1], line);
+              return (1);
+           }
+        if (src_farm < 0 || src_farm >= num_farms || des_farm < 0 || des_farm >= num_farms || km < 0 || km > UINT16_MAX)
+           {
+              fprintf(stderr, "Skipping pair %d,%d,%f: farm or distance out of range\n", src_farm, des_farm, km);
+              continue;
+           }
+        if (num_pairs + 2 > capacity)
+           {
+              capacity = capacity * 2;
+              pairs = (struct road_pair*)realloc(pairs, sizeof(struct road_pair) * capacity);
+           }
+        pairs[num_pairs].src_farm = src_farm;
+        pairs[num_pairs].des_farm = des_farm;
+        pairs[num_pairs].km = (int32_t)(km + 0.5); // whole km like rewire_calc_dis
+        pairs[num_pairs].listed = 1;
+        num_pairs++;
+        if (symmetric == 1)
+           {
+              pairs[num_pairs].src_farm = des_farm;
+              pairs[num_pairs].des_farm = src_farm;
+              pairs[num_pairs].km = pairs[num_pairs-1].km;
+              pairs[num_pairs].listed = 0;
+              num_pairs++;
+           }
+     }
+  fclose(Csv);
+
+/* 2. SORT BY SOURCE, DESTINATION; LISTED BEFORE MIRRORED, SHORTEST FIRST. KEEP THE FIRST OF EACH PAIR*/
+  qsort(pairs, num_pairs, sizeof(struct road_pair), comp_road_pair);
+  num_entries = 0;
+  for (i = 0; i < num_pairs; i++)
+     {
+        if (num_entries > 0 && pairs[i].src_farm == pairs[num_entries-1].src_farm && pairs[i].des_farm == pairs[num_entries-1].des_farm)
+           {
+              continue;
+           }
+        pairs[num_entries] = pairs[i];
+        num_entries++;
+     }
+
+/* 3. WRITE THE CSR FILE*/
+  Out = fopen(argv[3], "wb");
+  if (Out == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[3]);
+        return (1);
+     }
+  {
+     char magic[8] = ROAD_DISTANCE_MAGIC;
+     int64_t counts[2];
+     uint64_t row_start = 0;
+     int32_t des;
+     uint16_t dis;
+
+     counts[0] = num_farms;
+     counts[1] = num_entries;
+     ok = fwrite(magic, 1, sizeof(magic), Out) == sizeof(magic);
+     ok = ok && fwrite(counts, sizeof(int64_t), 2, Out) == 2;
+     k = 0;
+     for (i = 0; i <= num_farms; i++)
+        {
+           while (k < num_entries && pairs[k].src_farm < i)
+              {
+                 k++;
+              }
+           row_start = (uint64_t)k;
+           ok = ok && fwrite(&row_start, sizeof(uint64_t), 1, Out) == 1;
+        }
+     for (k = 0; k < num_entries; k++)
+        {
+           des = pairs[k].des_farm;
+           ok = ok && fwrite(&des, sizeof(int32_t), 1, Out) == 1;
+        }
+     for (k = 0; k < num_entries; k++)
+        {
+           dis = (uint16_t)pairs[k].km;
+           ok = ok && fwrite(&dis, sizeof(uint16_t), 1, Out) == 1;
+        }
+  }
+  if (fclose(Out) != 0 || !ok)
+     {
+        fprintf(stderr, "Can not write %s\n", argv[3]);
+        return (1);
+     }
+  printf("%ld road distances of %ld farms written to %s\n", num_entries, num_farms, argv[3]);
+
+  free(pairs);
+  return (0);
+}
+/* END OF MAIN PROGRAM*/
+
+/* ########################################################################## */
+/* FUNCTION CODE */
+
+/* -------------------------------------------------------------------------- */
+/* Sorting function*/
+/* -------------------------------------------------------------------------- */
+int comp_road_pair(const void *a, const void *b)
+{
+  const struct road_pair *x = (const struct road_pair*)a;
+  const struct road_pair *y = (const struct road_pair*)b;
+
+  if (x->src_farm != y->src_farm) return ((x->src_farm > y->src_farm) - (x->src_farm < y->src_farm));
+  if (x->des_farm != y->des_farm) return ((x->des_farm > y->des_farm) - (x->des_farm < y->des_farm));
+  if (x->listed != y->listed) return (y->listed - x->listed);
+  return ((x->km > y->km) - (x->km < y->km));
+}
+/* -------------------------------------------------------------------------- */
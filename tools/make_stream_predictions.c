@@ -0,0 +1,151 @@
+/*------------------------------------------------------------------------------*/
+/* Convert the predicted distances of DistanceIntervalFile into the binary file
+read by rewire_set_prediction_file, in the line order of the movement file.
+This code can be distributed under MIT License.
+Copyright (c) 2016 Arata Hidano
+----------------------------------------------------------------------------------
+Input: the movement CSV (source farm, destination farm, day, batch type, move_id,
+sorted by day as for stream_moves) and the DistanceIntervalFile CSV (num_covs
+rows of predicted distances, row move_id for a movement). The first num_simu
+values of each row are kept.
+
+Output (little-endian), one block per iteration:
+  char magic[8] = "RWPRED1"; int64_t num_moves; int64_t num_simu;
+  uint16_t km[num_simu][num_moves]; // km[i][k]: line k of the movement file in iteration i
+
+The engine reads block i line by line along with the movements of iteration i,
+so the rewiring never holds more than the predictions of its day window.
+
+Build: gcc -O2 -o make_stream_predictions tools/make_stream_predictions.c
+Usage: make_stream_predictions MoveDataFile.csv DistanceIntervalFile.csv num_covs num_simu PredictionFile.bin */
+/*------------------------------------------------------------------------------*/
+
+
+/* ########################################################################## */
+/* C LIBRARIES TO INCLUDE */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define PREDICTION_MAGIC "RWPRED1"
+
+
+/* ########################################################################## */
+/* MAIN PROGRAM */
+int main(int argc, char *argv[])
+{
+  long int num_covs, num_simu, num_moves = 0, capacity = 1024, line_num, col_num, i, k;
+  double src_farm, des_farm, day, batch_cat, move_id;
+  int d, c, ok;
+  uint16_t *CovPredData, *block;
+  int32_t *move_rows;
+  FILE *Moves, *DisInt, *Out;
+
+  if (argc < 6)
+     {
+        fprintf(stderr, "Usage: %s MoveDataFile.csv DistanceIntervalFile.csv num_covs num_simu PredictionFile.bin\n", argv[0]);
+        return (1);
+     }
+  num_covs = atol(argv[3]);
+  num_simu = atol(argv[4]);
+  if (num_covs <= 0 || num_simu <= 0)
+     {
+        fprintf(stderr, "num_covs and num_simu must be positive\n");
+        return (1);
+     }
+
+/* 1. READ THE PREDICTION ROW OF EVERY MOVEMENT, IN FILE ORDER*/
+  Moves = fopen(argv[1], "r");
+  if (Moves == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[1]);
+        return (1);
+     }
+  move_rows = (int32_t*)malloc(sizeof(int32_t) * capacity);
+  while (fscanf(Moves, "%lf,%lf,%lf,%lf,%lf", &src_farm, &des_farm, &day, &batch_cat, &move_id) == 5)
+     {
+        if (move_id < 0 || move_id >= num_covs)
+           {
+              fprintf(stderr, "Movement %ld of %s has move_id %.0f, outside the %ld rows of predictions\n", num_moves + 1, argv[1], move_id, num_covs);
+              return (1);
+           }
+        if (num_moves == capacity)
+           {
+              capacity = capacity * 2;
+              move_rows = (int32_t*)realloc(move_rows, sizeof(int32_t) * capacity);
+           }
+        move_rows[num_moves] = (int32_t)move_id;
+        num_moves++;
+     }
+  fclose(Moves);
+  if (num_moves == 0)
+     {
+        fprintf(stderr, "No movement read from %s\n", argv[1]);
+        return (1);
+     }
+
+/* 2. READ THE FIRST num_simu PREDICTED DISTANCES OF EACH ROW*/
+  DisInt = fopen(argv[2], "r");
+  if (DisInt == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[2]);
+        return (1);
+     }
+  CovPredData = (uint16_t*)malloc(sizeof(uint16_t) * num_covs * num_simu);
+  for (line_num = 0; line_num < num_covs; line_num++)
+     {
+        for (col_num = 0; col_num < num_simu; col_num++)
+           {
+              if (fscanf(DisInt, "%d,", &d) != 1 || d < 0 || d > UINT16_MAX)
+                 {
+                    fprintf(stderr, "Can not read prediction %ld of row %ld of %s\n", col_num + 1, line_num + 1, argv[2]);
+                    return (1);
+                 }
+              CovPredData[line_num * num_simu + col_num] = (uint16_t)d;
+           }
+        while ((c = fgetc(DisInt)) != '\n' && c != EOF)
+           {
+              ; // rest of the row
+           }
+     }
+  fclose(DisInt);
+
+/* 3. WRITE ONE BLOCK PER ITERATION*/
+  Out = fopen(argv[5], "wb");
+  if (Out == NULL)
+     {
+        fprintf(stderr, "Can not open %s\n", argv[5]);
+        return (1);
+     }
+  {
+     char magic[8] = PREDICTION_MAGIC;
+     int64_t counts[2];
+
+     counts[0] = num_moves;
+     counts[1] = num_simu;
+     ok = fwrite(magic, 1, sizeof(magic), Out) == sizeof(magic);
+     ok = ok && fwrite(counts, sizeof(int64_t), 2, Out) == 2;
+     block = (uint16_t*)malloc(sizeof(uint16_t) * num_moves);
+     for (i = 0; i < num_simu && ok; i++)
+        {
+           for (k = 0; k < num_moves; k++)
+              {
+                 block[k] = CovPredData[(long int)move_rows[k] * num_simu + i];
+              }
+           ok = fwrite(block, sizeof(uint16_t), num_moves, Out) == (size_t)num_moves;
+        }
+     free(block);
+  }
+  if (fclose(Out) != 0 || !ok)
+     {
+        fprintf(stderr, "Can not write %s\n", argv[5]);
+        return (1);
+     }
+  printf("Predictions of %ld movements in %ld iterations written to %s\n", num_moves, num_simu, argv[5]);
+
+  free(CovPredData);
+  free(move_rows);
+  return (0);
+}
+/* END OF MAIN PROGRAM*/